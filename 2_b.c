@@ -17,6 +17,7 @@
 int angle = 0;
 bool state = false;
 int direction = 0;
+QUEUE_DEFINE(buttonEvents, byte, 4)  // RB0 presses from H_ISR, consumed by main loop
 void onReadLine(char *line, byte len) {
     if (len && !strcmp(line, "mode1")) {
         state = false;
@@ -32,17 +33,7 @@ void onReadChar(char c) {
 
 void __interrupt(high_priority) H_ISR() {
     if (interruptByRB0External()) {
-        state = !state;
-
-        if (state) {
-            setCCP1ServoAngle(0, 16);
-            angle = 0;
-
-        } else {
-            angle = 1;
-            setCCP1ServoAngle(45, 16);
-        }
-        direction = 0;
+        buttonEventsPush(0);  // every press is kept, even if main is mid-sweep
         __delay_ms(0.75);
         clearInterrupt_RB0External();
     }
@@ -117,6 +108,21 @@ void main(void) {
     serialPrint("Ready\n");
 
     while (1) {
+        byte event;
+        while (buttonEventsPop(&event)) {
+            state = !state;
+
+            if (state) {
+                setCCP1ServoAngle(0, 16);
+                angle = 0;
+
+            } else {
+                angle = 1;
+                setCCP1ServoAngle(45, 16);
+            }
+            direction = 0;
+        }
+
         if (!state) {
             if (direction == 0) {
                 angle++;
@@ -21,6 +21,7 @@
 #include "C:/Program Files/Microchip/xc8/v2.50/pic/include/proc/pic18f4520.h"
 #define bit unsigned char   // 模擬位元型別
 #define bool unsigned char  // 模擬布林型別
+#define __uint24 unsigned long  // 模擬 XC8 的 24 位元無號整數型別
 #endif
 
 #include <stdio.h>
@@ -47,8 +48,14 @@
 #define XSTR(s) STR(s)                                                       // 展開後字串化
 #define MACRO_CODE_CONCAT(A, B) A##B                                         // 連接兩個符號
 #define MACRO_CODE_CONCAT3(A, B, C) A##B##C                                  // 連接三個符號
+#define MACRO_CODE_XCONCAT(A, B) MACRO_CODE_CONCAT(A, B)                     // 展開後連接兩個符號
+#define MACRO_CODE_STRING(A) #A                                              // 轉為字串
+#define MACRO_CODE_XSTRING(A) MACRO_CODE_STRING(A)                           // 展開後轉為字串
 #define _pinGetPortBits(reg, port, pin) MACRO_CODE_CONCAT3(reg, port, bits)  // 取得埠位元結構
 #define _pinGetPinBit(reg, port, pin) MACRO_CODE_CONCAT(reg, pin)            // 取得腳位位元
+#define _pinGetPort(reg, port, pin) MACRO_CODE_CONCAT(reg, port)             // 取得埠暫存器
+#define _pinGetPortId(port, pin) MACRO_CODE_CONCAT(_PIN_PORT_, port)         // 取得埠編號
+#define _pinGetMask(port, pin) (1 << MACRO_CODE_CONCAT(_PIN_BIT_, pin))      // 取得腳位遮罩
 
 /* ========== ADC 時脈來源設定 / ADC Clock Source Settings ========== */
 /**
@@ -77,6 +84,63 @@
 #define INTERNAL_CLOCK_250kHz 0b010  // 250 kHz
 #define INTERNAL_CLOCK_125kHz 0b001  // 125 kHz
 #define INTERNAL_CLOCK_31kHz 0b000   // 31 kHz (來自 INTOSC/256 或直接 INTRC)
+
+/* ========== 振盪器來源 / Oscillator Source ========== */
+/**
+ * OSCILLATOR_SOURCE: 系統時脈來源，可在 include 前定義 (預設為內部振盪器)
+ * 必須與 #pragma config OSC 設定一致
+ *
+ * - OSCILLATOR_INTERNAL: 內部振盪器 (OSC = INTIO67)，31 kHz ~ 32 MHz
+ * - OSCILLATOR_HS      : 外部高速石英 (OSC = HS)，4 ~ 25 MHz
+ * - OSCILLATOR_HSPLL   : 外部石英 + 4x PLL (OSC = HSPLL)，石英 4 ~ 10 MHz，系統 16 ~ 40 MHz
+ * - OSCILLATOR_EC      : 外部時脈輸入 (OSC = EC / ECIO6)，最高 40 MHz
+ */
+#define OSCILLATOR_INTERNAL 0
+#define OSCILLATOR_HS 1
+#define OSCILLATOR_HSPLL 2
+#define OSCILLATOR_EC 3
+
+#ifndef OSCILLATOR_SOURCE
+#define OSCILLATOR_SOURCE OSCILLATOR_INTERNAL
+#endif
+
+/**
+ * CLOCK_SCALING: 在 include 前定義以啟用執行期時脈切換 (setClockProfile()，見 ClockScaling)
+ * 未定義時計時器週期與系統時間皆以編譯期常數計算，重新載入不含執行期換算
+ */
+#if defined(CLOCK_SCALING) && (OSCILLATOR_SOURCE != OSCILLATOR_INTERNAL)
+#error "CLOCK_SCALING" 僅支援內部振盪器
+#endif
+
+#if (OSCILLATOR_SOURCE != OSCILLATOR_INTERNAL)
+/**
+ * 外部時脈來源: 檢查 _XTAL_FREQ 是否在該模式允許的範圍內
+ */
+#if (OSCILLATOR_SOURCE == OSCILLATOR_HS) && (_XTAL_FREQ < 4000000 || _XTAL_FREQ > 25000000)
+#error HS 模式的石英頻率 "_XTAL_FREQ" 必須介於 4 MHz 與 25 MHz 之間
+#elif (OSCILLATOR_SOURCE == OSCILLATOR_HSPLL) && (_XTAL_FREQ < 16000000 || _XTAL_FREQ > 40000000)
+#error HSPLL 模式的系統頻率 "_XTAL_FREQ" (石英 × 4) 必須介於 16 MHz 與 40 MHz 之間
+#elif (OSCILLATOR_SOURCE == OSCILLATOR_EC) && (_XTAL_FREQ > 40000000)
+#error EC 模式的外部時脈 "_XTAL_FREQ" 不可超過 40 MHz
+#elif (OSCILLATOR_SOURCE > OSCILLATOR_EC)
+#error 不合法的 "OSCILLATOR_SOURCE"
+#endif
+
+/**
+ * 依裝置頻率選擇 ADC 時脈來源，確保 TAD >= 0.7µs (見 AD_CLOCK_SOURCE_x 的最大裝置頻率)
+ */
+#if (_XTAL_FREQ <= 2860000)
+#define AD_CLOCK_SOURCE AD_CLOCK_SOURCE_2TOSC
+#elif (_XTAL_FREQ <= 5710000)
+#define AD_CLOCK_SOURCE AD_CLOCK_SOURCE_4TOSC
+#elif (_XTAL_FREQ <= 11430000)
+#define AD_CLOCK_SOURCE AD_CLOCK_SOURCE_8TOSC
+#elif (_XTAL_FREQ <= 22860000)
+#define AD_CLOCK_SOURCE AD_CLOCK_SOURCE_16TOSC
+#else
+#define AD_CLOCK_SOURCE AD_CLOCK_SOURCE_32TOSC
+#endif
+
 /**
  * 根據 _XTAL_FREQ 自動選擇對應的時脈設定
  * _XTAL_FREQ: 系統主頻率 (Hz)，需在專案設定中定義
@@ -84,7 +148,7 @@
  * 32MHz 和 16MHz 需要啟用 PLL (Phase-Locked Loop，鎖相迴路)
  * PLL 會將 8MHz/4MHz 內部振盪器倍頻至目標頻率
  */
-#if (_XTAL_FREQ == 32000000)
+#elif (_XTAL_FREQ == 32000000)
 // 32 MHz: 使用 8MHz 內部振盪器 + 4x PLL
 #define INTERNAL_CLOCK_IRCF INTERNAL_CLOCK_8MHz
 #define AD_CLOCK_SOURCE AD_CLOCK_SOURCE_32TOSC
@@ -131,7 +195,14 @@
 #endif
 
 /* ========== 內部時脈設定巨集 / Internal Clock Setup Macro ========== */
-#ifdef PLL_ENABLE
+#if (OSCILLATOR_SOURCE != OSCILLATOR_INTERNAL)
+/**
+ * setIntrnalClock() - 外部時脈來源: 選擇主振盪器
+ *
+ * 外部石英/PLL 由組態位元啟用，此處只確保 SCS = 00 (使用組態位元指定的主振盪器)
+ */
+#define setIntrnalClock() OSCCONbits.SCS = 0b00
+#elif defined(PLL_ENABLE)
 /**
  * setIntrnalClock() - 設定內部振盪器時脈 (含 PLL)
  *
@@ -182,7 +253,7 @@
 #elif (AD_CLOCK_SOURCE == AD_CLOCK_SOURCE_8TOSC)
 #define _AD_CONVETER_TAD 8 * 1000000000 / _XTAL_FREQ  // TAD = 8/FOSC
 #elif (AD_CLOCK_SOURCE == AD_CLOCK_SOURCE_16TOSC)
-#define _AD_CONVETER_TAD 12 * 1000000000 / _XTAL_FREQ  // TAD = 12/FOSC
+#define _AD_CONVETER_TAD 16 * 1000000000 / _XTAL_FREQ  // TAD = 16/FOSC
 #elif (AD_CLOCK_SOURCE == AD_CLOCK_SOURCE_32TOSC)
 #define _AD_CONVETER_TAD 32 * 1000000000 / _XTAL_FREQ  // TAD = 32/FOSC
 #elif (AD_CLOCK_SOURCE == AD_CLOCK_SOURCE_64TOSC)
@@ -222,6 +293,8 @@
 #define AD_ACQUISITION_TIME AD_ACQUISITION_TIME_16TAD
 #elif (20 * _AD_CONVETER_TAD > MINIMUM_ACQUISITION_TIME)
 #define AD_ACQUISITION_TIME AD_ACQUISITION_TIME_20TAD
+#else
+#error 無法以 20 TAD 以內滿足最小取樣時間，請檢查 AD_CLOCK_SOURCE
 #endif
 #pragma endregion AD_AcquisitionTime
 
@@ -312,6 +385,20 @@
     _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1) <= 65535, "Period time too long"); \
     TMR0 = (uint16_t)(65535 - (period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1)
 
+/**
+ * addTimer0InterruptPeriod16() - 以累加方式重新載入 16 位元模式的中斷週期
+ * @param period    週期時間 (微秒 µs)
+ * @param prescale  預分頻比數值 (2, 4, 8, 16, 32, 64, 128, 256)
+ *
+ * 在溢位中斷中取代 setTimer0InterruptPeriod16() 使用
+ * TMR0 += 預載值: 保留中斷延遲期間已經計數的值，中斷延遲本身不會累積
+ * 寫入 TMR0 會清除預分頻器，每次重載遺失 0 ~ prescale-1 個指令週期 (不足 1 個計數)，
+ * 加上讀寫 TMR0 之間的數個指令週期，這部分每個週期都會累積；需要無漂移的週期時改用 CCP 特殊事件觸發
+ */
+#define addTimer0InterruptPeriod16(period, prescale)                                                                     \
+    _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1) <= 65535, "Period time too long"); \
+    TMR0 += (uint16_t)(65535 - (period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1)
+
 #pragma endregion Timer0
 
 /* ========== 計時器1 / Timer1 ========== */
@@ -368,16 +455,57 @@
 
 #define interruptByTimer1Overflow() PIR1bits.TMR1IF  // 檢查是否為 Timer1 溢位中斷
 
+/* 週期計數 (編譯期計數頻率)，與 setTimer1InterruptPeriod() 的預載值互補: TMR1 = 65536 - 計數 */
+#define _timerCounts(period, prescale) ((uint16_t)(65536UL - (uint16_t)(65535 - (period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1)))
+
+#ifdef CLOCK_SCALING
+/**
+ * _timerShift() - 以實際計數頻率換算計數
+ * @param counts  計數 (編譯期計數頻率)
+ * @param shift   實際計數頻率相對編譯期的 2 的冪次 (setClockProfile() 無法以預分頻比吸收時不為 0)
+ */
+#define _timerShift(counts, shift) \
+    (!(shift) ? (uint32_t)(counts) : (shift) > 0 ? (uint32_t)(counts) << (shift) : (uint32_t)(counts) >> -(shift))
+#define _timerPreload(counts, shift) ((uint16_t)(0 - _timerShift(counts, shift)))  // 週期計數換算為預載值
+
+signed char timer1CountShift;   // Timer1 計數頻率相對 _XTAL_FREQ 的 2 的冪次 (由 setClockProfile() 設定)
+uint16_t timer1PeriodCounts;    // 最近一次 setTimer1InterruptPeriod() 的週期計數，0 = 自由計數
+
+#define _timer1Period(counts) (timer1PeriodCounts = (counts), _timerPreload(counts, timer1CountShift))  // 記錄週期並換算預載值
+#define _timer1Reload(counts) _timerPreload(counts, timer1CountShift)                                     // 換算預載值
+#define _timer1FreeRunning() timer1PeriodCounts = 0                                                        // 自由計數 (無週期)
+#else
+/* 未啟用 CLOCK_SCALING: 預載值為編譯期常數 */
+#define _timer1Period(counts) ((uint16_t)(0 - (counts)))
+#define _timer1Reload(counts) ((uint16_t)(0 - (counts)))
+#define _timer1FreeRunning()
+#endif
+
 /**
  * setTimer1InterruptPeriod() - 設定 Timer1 中斷週期
  * @param period    週期時間 (微秒 µs)
  * @param prescale  預分頻比數值 (1, 2, 4, 8)
  *
  * 計算公式: TMR1 = 65535 - (period × FOSC) / (4 × prescale × 10^6) + 1
+ * 啟用 CLOCK_SCALING 時 setClockProfile() 切換時脈後依 timer1CountShift 換算，週期維持不變
  */
 #define setTimer1InterruptPeriod(period, prescale)                                                                       \
     _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1) <= 65535, "Period time too long"); \
-    TMR1 = (uint16_t)(65535 - (period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1)
+    TMR1 = _timer1Period(_timerCounts(period, prescale))
+
+/**
+ * addTimer1InterruptPeriod() - 以累加方式重新載入 Timer1 中斷週期
+ * @param period    週期時間 (微秒 µs)
+ * @param prescale  預分頻比數值 (1, 2, 4, 8)
+ *
+ * 在溢位中斷中取代 setTimer1InterruptPeriod() 使用，中斷延遲本身不會累積
+ * 寫入 TMR1 會清除預分頻器: 每次重載遺失 0 ~ prescale-1 個指令週期，加上讀寫 TMR1 之間的數個指令週期，
+ * 每個週期最多慢 prescale + 4 個指令週期並會累積 (如 1:8、10ms @ 4MHz 約 0.1%)；預分頻 1:1 時只剩固定的讀寫延遲
+ * 需要無漂移的週期時改用 CCP 特殊事件觸發 (setCCP1SpecialEventPeriod)
+ */
+#define addTimer1InterruptPeriod(period, prescale)                                                                       \
+    _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1) <= 65535, "Period time too long"); \
+    TMR1 += _timer1Reload(_timerCounts(period, prescale))
 #pragma endregion Timer1
 
 /* ========== 計時器2 / Timer2 ========== */
@@ -445,6 +573,14 @@
     PIE1bits.TMR2IE = 0b0;           \
     clearInterrupt_Timer2PR2()
 
+#ifdef CLOCK_SCALING
+signed char timer2CountShift;  // Timer2 計數頻率相對 _XTAL_FREQ 的 2 的冪次 (由 setClockProfile() 設定)
+
+#define _timer2Scale(counts) ((uint16_t)_timerShift(counts, timer2CountShift))  // 換算為實際計數頻率的計數
+#else
+#define _timer2Scale(counts) (counts)
+#endif
+
 /**
  * setTimer2InterruptPeriod() - 設定 Timer2 中斷週期
  * @param period    週期時間 (微秒 µs)
@@ -453,10 +589,11 @@
  *
  * 計算公式: PR2 = (period × FOSC) / (4 × prescale × postscale × 10^6) - 1
  * 此值設定 TMR2 從 0 計數到 PR2 的週期
+ * 啟用 CLOCK_SCALING 時依 timer2CountShift 換算 (setClockProfile() 可能改變時脈與預分頻比)
  */
 #define setTimer2InterruptPeriod(period, prescale, postscale)                                                                      \
     _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale / postscale - 1) <= 255, "Period time too long"); \
-    PR2 = (byte)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale / postscale - 1)
+    PR2 = (byte)(_timer2Scale((uint16_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale / postscale)) - 1)
 
 #pragma endregion Timer2
 
@@ -502,16 +639,44 @@
 
 #define interruptByTimer3Overflow() PIR2bits.TMR3IF  // 檢查是否為 Timer3 溢位中斷
 
+#ifdef CLOCK_SCALING
+signed char timer3CountShift;   // Timer3 計數頻率相對 _XTAL_FREQ 的 2 的冪次 (由 setClockProfile() 設定)
+uint16_t timer3PeriodCounts;    // 最近一次 setTimer3InterruptPeriod() 的週期計數，0 = 自由計數
+
+#define _timer3Period(counts) (timer3PeriodCounts = (counts), _timerPreload(counts, timer3CountShift))  // 記錄週期並換算預載值
+#define _timer3Reload(counts) _timerPreload(counts, timer3CountShift)                                     // 換算預載值
+#define _timer3FreeRunning() timer3PeriodCounts = 0                                                        // 自由計數 (無週期)
+#else
+#define _timer3Period(counts) ((uint16_t)(0 - (counts)))
+#define _timer3Reload(counts) ((uint16_t)(0 - (counts)))
+#define _timer3FreeRunning()
+#endif
+
 /**
  * setTimer3InterruptPeriod() - 設定 Timer3 中斷週期
  * @param period    週期時間 (微秒 µs)
  * @param prescale  預分頻比數值 (1, 2, 4, 8)
  *
  * 計算公式: TMR3 = 65535 - (period × FOSC) / (4 × prescale × 10^6) + 1
+ * 啟用 CLOCK_SCALING 時 setClockProfile() 切換時脈後依 timer3CountShift 換算，週期維持不變
  */
 #define setTimer3InterruptPeriod(period, prescale)                                                                       \
     _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1) <= 65535, "Period time too long"); \
-    TMR3 = (uint16_t)(65535 - (period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1)
+    TMR3 = _timer3Period(_timerCounts(period, prescale))
+
+/**
+ * addTimer3InterruptPeriod() - 以累加方式重新載入 Timer3 中斷週期
+ * @param period    週期時間 (微秒 µs)
+ * @param prescale  預分頻比數值 (1, 2, 4, 8)
+ *
+ * 在溢位中斷中取代 setTimer3InterruptPeriod() 使用，中斷延遲本身不會累積
+ * 寫入 TMR3 會清除預分頻器: 每次重載遺失 0 ~ prescale-1 個指令週期，加上讀寫 TMR3 之間的數個指令週期，
+ * 每個週期最多慢 prescale + 4 個指令週期並會累積 (如 1:8、10ms @ 4MHz 約 0.1%)；預分頻 1:1 時只剩固定的讀寫延遲
+ * 需要無漂移的週期時改用 CCP 特殊事件觸發 (setCCP2SpecialEventPeriod)
+ */
+#define addTimer3InterruptPeriod(period, prescale)                                                                       \
+    _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale + 1) <= 65535, "Period time too long"); \
+    TMR3 += _timer3Reload(_timerCounts(period, prescale))
 
 #pragma endregion Timer3
 
@@ -555,6 +720,39 @@
 #define setCCP1Mode(eccpMode) CCP1CONbits.CCP1M = eccpMode  // 設定 CCP1 模式
 #define setCCP2Mode(eccpMode) CCP2CONbits.CCP2M = eccpMode  // 設定 CCP2 模式
 
+/* CCP 捕獲/比較時基選擇 (T3CON 的 T3CCP2:T3CCP1 位元) */
+#define CCP_TIMER_SOURCE_T1_T1 0b00  // CCP1、CCP2 皆使用 Timer1
+#define CCP_TIMER_SOURCE_T1_T3 0b01  // CCP1 使用 Timer1，CCP2 使用 Timer3
+#define CCP_TIMER_SOURCE_T3_T3 0b10  // CCP1、CCP2 皆使用 Timer3
+
+/**
+ * setCCPTimerSource() - 設定 CCP 捕獲/比較模式使用的計時器
+ * @param source  時基選擇 (CCP_TIMER_SOURCE_x)
+ */
+#define setCCPTimerSource(source)             \
+    T3CONbits.T3CCP2 = ((source) >> 1) & 0b1; \
+    T3CONbits.T3CCP1 = (source) & 0b1
+
+/**
+ * setCCP1SpecialEventPeriod() / setCCP2SpecialEventPeriod() - 以特殊事件觸發產生精確週期
+ * @param period    週期時間 (微秒 µs)
+ * @param prescale  時基計時器預分頻比數值 (1, 2, 4, 8)
+ *
+ * 比較模式 ECCP_MODE_COMPARE_TSE: 計時器與 CCPRx 相符時由硬體重設為 0 並設定 CCPxIF
+ * 週期完全由硬體決定，不需在中斷中重新載入，也不受中斷延遲影響
+ * CCP2 的特殊事件同時會啟動 A/D 轉換 (ADC 已啟用時)
+ * 時基計時器由 setCCPTimerSource() 決定，啟用計時器後不可再寫入 TMRx
+ */
+#define setCCP1SpecialEventPeriod(period, prescale)                                                                  \
+    _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale) <= 65536, "Period time too long"); \
+    CCPR1 = (uint16_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale - 1);                                      \
+    setCCP1Mode(ECCP_MODE_COMPARE_TSE)
+
+#define setCCP2SpecialEventPeriod(period, prescale)                                                                  \
+    _Static_assert((uint32_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale) <= 65536, "Period time too long"); \
+    CCPR2 = (uint16_t)((period) / (1000000.0 / _XTAL_FREQ) / 4 / prescale - 1);                                      \
+    setCCP2Mode(ECCP_MODE_COMPARE_TSE)
+
 /**
  * setCCP1PwmDutyCycle() - 設定 CCP1 PWM 佔空比
  * @param length    高電位時間長度 (微秒 µs)
@@ -562,12 +760,13 @@
  *
  * PWM 佔空比 = (CCPR1L:DC1B) × TOSC × Timer2 預分頻比
  * 10 位元解析度: CCPR1L (高 8 位) + DC1B (低 2 位)
+ * 啟用 CLOCK_SCALING 時依 timer2CountShift 換算，切換時脈後脈寬不變
  */
-#define setCCP1PwmDutyCycle(length, prescale)                                                \
-    do {                                                                                     \
-        unsigned int value = (unsigned int)((length) / (1000000.0 / _XTAL_FREQ) / prescale); \
-        CCP1CONbits.DC1B = (byte)value & 0b11; /* 低 2 位 */                                 \
-        CCPR1L = (byte)(value >> 2);           /* 高 8 位 */                                 \
+#define setCCP1PwmDutyCycle(length, prescale)                                                              \
+    do {                                                                                                   \
+        unsigned int value = _timer2Scale((unsigned int)((length) / (1000000.0 / _XTAL_FREQ) / prescale)); \
+        CCP1CONbits.DC1B = (byte)value & 0b11; /* 低 2 位 */                                               \
+        CCPR1L = (byte)(value >> 2);           /* 高 8 位 */                                               \
     } while (0)
 
 /**
@@ -577,12 +776,13 @@
  *
  * PWM 佔空比 = (CCPR2L:DC2B) × TOSC × Timer2 預分頻比
  * 10 位元解析度: CCPR2L (高 8 位) + DC2B (低 2 位)
+ * 啟用 CLOCK_SCALING 時依 timer2CountShift 換算，切換時脈後脈寬不變
  */
-#define setCCP2PwmDutyCycle(length, prescale)                                                \
-    do {                                                                                     \
-        unsigned int value = (unsigned int)((length) / (1000000.0 / _XTAL_FREQ) / prescale); \
-        CCP2CONbits.DC2B = (byte)value & 0b11; /* 低 2 位 */                                 \
-        CCPR2L = (byte)(value >> 2);           /* 高 8 位 */                                 \
+#define setCCP2PwmDutyCycle(length, prescale)                                                              \
+    do {                                                                                                   \
+        unsigned int value = _timer2Scale((unsigned int)((length) / (1000000.0 / _XTAL_FREQ) / prescale)); \
+        CCP2CONbits.DC2B = (byte)value & 0b11; /* 低 2 位 */                                               \
+        CCPR2L = (byte)(value >> 2);           /* 高 8 位 */                                               \
     } while (0)
 
 #pragma endregion PWM_Control
@@ -659,6 +859,7 @@
  * - pinMode(PIN_RA0, PIN_OUTPUT);  // 設定 RA0 為輸出
  * - digitalWrite(PIN_RA0, 1);      // 設定 RA0 輸出高電位
  * - byte state = pinState(PIN_RA0); // 讀取 RA0 輸出狀態
+ * - byte level = digitalRead(PIN_RB0); // 讀取 RB0 輸入電位
  */
 
 /* 腳位方向設定 (TRISx 暫存器) */
@@ -691,6 +892,23 @@
  */
 #define pinState(pin) _pinGetPortBits(LAT, pin)._pinGetPinBit(L, pin)
 
+/**
+ * digitalRead() - 讀取腳位輸入電位
+ * @param pin  腳位 (使用 PIN_Rxx 巨集)
+ * @return     腳位實際電位 (0 或 1)
+ *
+ * 操作 PORTx 暫存器的對應位元，展開為單一位元測試指令
+ * 讀取的是腳位電位，與 pinState() 讀取的輸出鎖存值不同
+ */
+#define digitalRead(pin) _pinGetPortBits(PORT, pin)._pinGetPinBit(R, pin)
+
+/**
+ * portRead() - 讀取整個埠的輸入電位
+ * @param port  埠 (A, B, C, D, E)
+ * @return      PORTx 位元組
+ */
+#define portRead(port) MACRO_CODE_CONCAT(PORT, port)
+
 /* PORTB 內部上拉電阻控制 */
 #define PORTB_PULLUP_ENABLE 0b0   // 啟用 PORTB 內部上拉電阻
 #define PORTB_PULLUP_DISABLE 0b1  // 停用 PORTB 內部上拉電阻
@@ -703,6 +921,194 @@
  * 當設定為輸入時，可用於按鈕等應用，省去外部上拉電阻
  */
 #define setPortBPullup(state) INTCON2bits.RBPU = state
+
+/* 腳位所屬埠編號與位元位置，供腳位群組在編譯期計算遮罩 */
+#define _PIN_PORT_A 0
+#define _PIN_PORT_B 1
+#define _PIN_PORT_C 2
+#define _PIN_PORT_D 3
+#define _PIN_PORT_E 4
+#define _PIN_BIT_A0 0
+#define _PIN_BIT_A1 1
+#define _PIN_BIT_A2 2
+#define _PIN_BIT_A3 3
+#define _PIN_BIT_A4 4
+#define _PIN_BIT_A5 5
+#define _PIN_BIT_A6 6
+#define _PIN_BIT_A7 7
+#define _PIN_BIT_B0 0
+#define _PIN_BIT_B1 1
+#define _PIN_BIT_B2 2
+#define _PIN_BIT_B3 3
+#define _PIN_BIT_B4 4
+#define _PIN_BIT_B5 5
+#define _PIN_BIT_B6 6
+#define _PIN_BIT_B7 7
+#define _PIN_BIT_C0 0
+#define _PIN_BIT_C1 1
+#define _PIN_BIT_C2 2
+#define _PIN_BIT_C3 3
+#define _PIN_BIT_C4 4
+#define _PIN_BIT_C5 5
+#define _PIN_BIT_C6 6
+#define _PIN_BIT_C7 7
+#define _PIN_BIT_D0 0
+#define _PIN_BIT_D1 1
+#define _PIN_BIT_D2 2
+#define _PIN_BIT_D3 3
+#define _PIN_BIT_D4 4
+#define _PIN_BIT_D5 5
+#define _PIN_BIT_D6 6
+#define _PIN_BIT_D7 7
+#define _PIN_BIT_E0 0
+#define _PIN_BIT_E1 1
+#define _PIN_BIT_E2 2
+
+/**
+ * 腳位群組: 同一個埠上的多個腳位，以一次遮罩讀-修改-寫更新 LATx
+ *
+ * 使用方式:
+ * - #define LED_GROUP PIN_GROUP(D, 0, 4)        // RD0-RD3，值的 bit 0 對應 RD0
+ * - digitalWriteGroup(LED_GROUP, 0b0101);      // LATD = (LATD & ~0x0F) | 0b0101
+ *
+ * 群組在編譯期展開為 (埠, 遮罩, 位移)，產生的程式碼與手寫暫存器操作相同
+ * 所有腳位同時改變，不會有逐位元更新的中間狀態
+ */
+
+/**
+ * PIN_GROUP() - 宣告同一埠上連續的腳位群組
+ * @param port   埠 (A, B, C, D, E)
+ * @param first  最低位元的腳位編號 (0-7)
+ * @param count  腳位數量
+ */
+#define PIN_GROUP(port, first, count) port, ((((1 << (count)) - 1) << (first)) & 0xFF), first
+
+/**
+ * PIN_GROUP_MASK() - 宣告同一埠上任意腳位的群組
+ * @param port  埠 (A, B, C, D, E)
+ * @param mask  腳位遮罩，寫入值的位元位置與埠相同
+ */
+#define PIN_GROUP_MASK(port, mask) port, mask, 0
+
+/**
+ * digitalWriteGroup() - 一次寫入腳位群組
+ * @param group  腳位群組 (PIN_GROUP / PIN_GROUP_MASK)
+ * @param value  輸出值 (bit 0 對應群組最低位元的腳位)
+ */
+#define digitalWriteGroup(group, value) _pinGroupWrite(group, value)
+#define _pinGroupWrite(port, mask, shift, value) \
+    MACRO_CODE_CONCAT(LAT, port) = (byte)((MACRO_CODE_CONCAT(LAT, port) & (byte)~(mask)) | (((byte)(value) << (shift)) & (mask)))
+
+/**
+ * digitalReadGroup() - 一次讀取腳位群組的輸入電位
+ * @param group  腳位群組 (PIN_GROUP / PIN_GROUP_MASK)
+ * @return       (PORTx & mask) >> first，bit 0 對應群組最低位元的腳位
+ */
+#define digitalReadGroup(group) _pinGroupRead(PORT, group)
+
+/**
+ * pinStateGroup() - 讀取腳位群組的輸出鎖存值
+ * @param group  腳位群組 (PIN_GROUP / PIN_GROUP_MASK)
+ */
+#define pinStateGroup(group) _pinGroupRead(LAT, group)
+#define _pinGroupRead(reg, port, mask, shift) ((byte)((MACRO_CODE_CONCAT(reg, port) & (mask)) >> (shift)))
+
+/**
+ * 埠快照: 連續讀取 PORTA ~ PORTE，所有輸入在數個指令週期內取樣
+ * 之後從快照解析各腳位，不會因為逐一讀取而得到不同時間點的值
+ *
+ * 使用方式:
+ * - PortSnapshot snapshot;
+ * - portSnapshot(snapshot);
+ * - if (snapshotRead(snapshot, PIN_RB0) && snapshotReadGroup(snapshot, LED_GROUP) == 0) ...
+ */
+typedef struct {
+    byte ports[5];  // 依 _PIN_PORT_x 排列: A, B, C, D, E
+} PortSnapshot;
+
+/**
+ * portSnapshot() - 連續讀取所有埠
+ * @param snapshot  PortSnapshot 變數
+ */
+#define portSnapshot(snapshot)   \
+    (snapshot).ports[0] = PORTA; \
+    (snapshot).ports[1] = PORTB; \
+    (snapshot).ports[2] = PORTC; \
+    (snapshot).ports[3] = PORTD; \
+    (snapshot).ports[4] = PORTE
+
+/**
+ * snapshotRead() - 從快照讀取腳位電位
+ * @param snapshot  PortSnapshot 變數
+ * @param pin       腳位 (使用 PIN_Rxx 巨集)
+ * @return          0 或 1
+ */
+#define snapshotRead(snapshot, pin) _snapshotRead(snapshot, pin)
+#define _snapshotRead(snapshot, port, pin) (((snapshot).ports[_pinGetPortId(port, pin)] & _pinGetMask(port, pin)) != 0)
+
+/**
+ * snapshotReadGroup() - 從快照讀取腳位群組
+ * @param snapshot  PortSnapshot 變數
+ * @param group     腳位群組 (PIN_GROUP / PIN_GROUP_MASK)
+ */
+#define snapshotReadGroup(snapshot, group) _snapshotReadGroup(snapshot, group)
+#define _snapshotReadGroup(snapshot, port, mask, shift) ((byte)(((snapshot).ports[MACRO_CODE_CONCAT(_PIN_PORT_, port)] & (mask)) >> (shift)))
+
+/**
+ * _pinBitIf() - 若腳位屬於指定埠且條件成立，回傳腳位遮罩
+ *
+ * 埠編號與遮罩皆為常數，條件為常數時整個運算式在編譯期計算
+ * 腳位巨集 (PIN_Rxx) 傳入內部巨集時已展開為 (埠, 腳位) 兩個參數
+ */
+#define _pinBitIf(portId, port, pin, condition) ((_pinGetPortId(port, pin) == (portId)) && (condition) ? _pinGetMask(port, pin) : 0)
+
+/**
+ * _pinMaskedWrite() - 以遮罩更新一個埠，遮罩為 0 時由編譯器移除
+ */
+#define _pinMaskedWrite(portReg, mask, value) \
+    if (mask)                                 \
+    portReg = (byte)((portReg & (byte)~(mask)) | (value))
+
+#define _pinWrite3(portReg, portId, n, port0, pin0, port1, pin1, port2, pin2)                                                  \
+    _pinMaskedWrite(portReg,                                                                                                   \
+                    _pinBitIf(portId, port0, pin0, 1) | _pinBitIf(portId, port1, pin1, 1) | _pinBitIf(portId, port2, pin2, 1), \
+                    _pinBitIf(portId, port0, pin0, (n) & 1) | _pinBitIf(portId, port1, pin1, (n) & 2) |                        \
+                        _pinBitIf(portId, port2, pin2, (n) & 4))
+
+#define _pinWrite4(portReg, portId, n, port0, pin0, port1, pin1, port2, pin2, port3, pin3)                                      \
+    _pinMaskedWrite(portReg,                                                                                                    \
+                    _pinBitIf(portId, port0, pin0, 1) | _pinBitIf(portId, port1, pin1, 1) | _pinBitIf(portId, port2, pin2, 1) | \
+                        _pinBitIf(portId, port3, pin3, 1),                                                                      \
+                    _pinBitIf(portId, port0, pin0, (n) & 1) | _pinBitIf(portId, port1, pin1, (n) & 2) |                         \
+                        _pinBitIf(portId, port2, pin2, (n) & 4) | _pinBitIf(portId, port3, pin3, (n) & 8))
+
+/**
+ * digitalWritePins3() / digitalWritePins4() - 將數值寫入可能分散在不同埠的腳位
+ * @param n     數值，bit i 對應 pin i
+ * @param pinX  腳位 (使用 PIN_Rxx 巨集)
+ *
+ * 每個用到的埠只寫入一次，同一埠上的腳位同時改變
+ * 全部腳位位於同一埠且連續時，改用 digitalWriteGroup() 可省去逐位元判斷
+ */
+#define digitalWritePins3(n, pin0, pin1, pin2)            \
+    do {                                                  \
+        byte _pinValue = (byte)(n);                       \
+        _pinWrite3(LATA, 0, _pinValue, pin0, pin1, pin2); \
+        _pinWrite3(LATB, 1, _pinValue, pin0, pin1, pin2); \
+        _pinWrite3(LATC, 2, _pinValue, pin0, pin1, pin2); \
+        _pinWrite3(LATD, 3, _pinValue, pin0, pin1, pin2); \
+        _pinWrite3(LATE, 4, _pinValue, pin0, pin1, pin2); \
+    } while (0)
+
+#define digitalWritePins4(n, pin0, pin1, pin2, pin3)            \
+    do {                                                        \
+        byte _pinValue = (byte)(n);                             \
+        _pinWrite4(LATA, 0, _pinValue, pin0, pin1, pin2, pin3); \
+        _pinWrite4(LATB, 1, _pinValue, pin0, pin1, pin2, pin3); \
+        _pinWrite4(LATC, 2, _pinValue, pin0, pin1, pin2, pin3); \
+        _pinWrite4(LATD, 3, _pinValue, pin0, pin1, pin2, pin3); \
+        _pinWrite4(LATE, 4, _pinValue, pin0, pin1, pin2, pin3); \
+    } while (0)
 #pragma endregion PinControl
 
 /* ========== 類比數位轉換器控制 / ADC Control ========== */
@@ -949,6 +1355,68 @@
 
 #define interruptByReceiveUART() PIR1bits.RCIF  // 檢查是否為 UART 接收中斷
 
+/* ---------- CCP1 捕獲/比較中斷 ---------- */
+#define clearInterrupt_CCP1() PIR1bits.CCP1IF = 0b0  // 清除 CCP1 中斷旗標
+
+/**
+ * enableInterrupt_CCP1() - 啟用 CCP1 捕獲/比較中斷
+ * @param priority  中斷優先權 (1=高, 0=低)
+ */
+#define enableInterrupt_CCP1(priority)              \
+    clearInterrupt_CCP1();                          \
+    PIE1bits.CCP1IE = 0b1;     /* 啟用 CCP1 中斷 */ \
+    IPR1bits.CCP1IP = priority /* 設定優先權 */
+
+#define disableInterrupt_CCP1() PIE1bits.CCP1IE = 0b0  // 停用 CCP1 中斷
+#define interruptByCCP1() PIR1bits.CCP1IF              // 檢查是否為 CCP1 中斷
+
+/* ---------- CCP2 捕獲/比較中斷 ---------- */
+#define clearInterrupt_CCP2() PIR2bits.CCP2IF = 0b0  // 清除 CCP2 中斷旗標
+
+/**
+ * enableInterrupt_CCP2() - 啟用 CCP2 捕獲/比較中斷
+ * @param priority  中斷優先權 (1=高, 0=低)
+ */
+#define enableInterrupt_CCP2(priority)              \
+    clearInterrupt_CCP2();                          \
+    PIE2bits.CCP2IE = 0b1;     /* 啟用 CCP2 中斷 */ \
+    IPR2bits.CCP2IP = priority /* 設定優先權 */
+
+#define disableInterrupt_CCP2() PIE2bits.CCP2IE = 0b0  // 停用 CCP2 中斷
+#define interruptByCCP2() PIR2bits.CCP2IF              // 檢查是否為 CCP2 中斷
+
+/* ---------- EEPROM 寫入完成中斷 (未寫入 EEPROM 時可作為軟體觸發中斷) ---------- */
+#define clearInterrupt_EEPROMWrite() PIR2bits.EEIF = 0b0    // 清除 EEPROM 寫入完成中斷旗標
+#define triggerInterrupt_EEPROMWrite() PIR2bits.EEIF = 0b1  // 以軟體設定旗標觸發中斷
+
+/**
+ * enableInterrupt_EEPROMWrite() - 啟用 EEPROM 寫入完成中斷
+ * @param priority  中斷優先權 (1=高, 0=低)
+ */
+#define enableInterrupt_EEPROMWrite(priority)       \
+    clearInterrupt_EEPROMWrite();                   \
+    PIE2bits.EEIE = 0b1;     /* 啟用 EEPROM 中斷 */ \
+    IPR2bits.EEIP = priority /* 設定優先權 */
+
+#define disableInterrupt_EEPROMWrite() PIE2bits.EEIE = 0b0  // 停用 EEPROM 寫入完成中斷
+#define interruptByEEPROMWrite() PIR2bits.EEIF              // 檢查是否為 EEPROM 寫入完成中斷
+
+/* ---------- MSSP 匯流排碰撞中斷 (未使用 I2C 主控時可作為軟體觸發中斷) ---------- */
+#define clearInterrupt_BusCollision() PIR2bits.BCLIF = 0b0    // 清除匯流排碰撞中斷旗標
+#define triggerInterrupt_BusCollision() PIR2bits.BCLIF = 0b1  // 以軟體設定旗標觸發中斷
+
+/**
+ * enableInterrupt_BusCollision() - 啟用 MSSP 匯流排碰撞中斷
+ * @param priority  中斷優先權 (1=高, 0=低)
+ */
+#define enableInterrupt_BusCollision(priority)   \
+    clearInterrupt_BusCollision();               \
+    PIE2bits.BCLIE = 0b1;     /* 啟用碰撞中斷 */ \
+    IPR2bits.BCLIP = priority /* 設定優先權 */
+
+#define disableInterrupt_BusCollision() PIE2bits.BCLIE = 0b0  // 停用匯流排碰撞中斷
+#define interruptByBusCollision() PIR2bits.BCLIF              // 檢查是否為匯流排碰撞中斷
+
 #pragma endregion InterruptControl
 
 /* ========== UART 串列通訊 / Serial Communication ========== */
@@ -1018,17 +1486,20 @@ inline void serialBegin(long baudRate, byte receiveInterruptPriority) {
     TXSTAbits.SYNC = 0;     // 非同步模式
     BAUDCONbits.BRG16 = 1;  // 使用 16 位元鮑率產生器
 
-    long baudRateGenerator = _XTAL_FREQ / baudRate;
+    long divider;
     TXSTAbits.BRGH = baudRate > 2400;  // 高鮑率選擇位元
 
     // 根據設定計算分頻比
     // 參考: https://ww1.microchip.com/downloads/en/devicedoc/39631e.pdf#page=207
     if (!TXSTAbits.SYNC && !BAUDCONbits.BRG16 && !TXSTAbits.BRGH)
-        baudRateGenerator /= 64;
+        divider = 64;
     else if (!TXSTAbits.SYNC && BAUDCONbits.BRG16 != TXSTAbits.BRGH)
-        baudRateGenerator /= 16;
+        divider = 16;
     else
-        baudRateGenerator /= 4;
+        divider = 4;
+
+    // 鮑率 = FOSC / (divider × (n + 1))，四捨五入取最接近的 n
+    long baudRateGenerator = (_XTAL_FREQ / divider + baudRate / 2) / baudRate - 1;
 
     // 設定鮑率產生器暫存器
     SPBRGH = (byte)(baudRateGenerator >> 8);  // 高位元組
@@ -1216,19 +1687,14 @@ bool processSerialReceive() {
  * @param pin1  bit 1 腳位 / bit 1 pin
  * @param pin2  bit 2 (MSB) 腳位 / bit 2 (MSB) pin
  */
-#define displayBinary3Pins(n, pin0, pin1, pin2) \
-    do {                                        \
-        digitalWrite(pin0, ((n) >> 0) & 1);     \
-        digitalWrite(pin1, ((n) >> 1) & 1);     \
-        digitalWrite(pin2, ((n) >> 2) & 1);     \
-    } while (0)
+#define displayBinary3Pins digitalWritePins3  // 直接別名: 腳位參數不可先經過一層巨集展開
 
 /**
  * displayBinary3() - 在 RD0-RD2 顯示 3 位元二進位值
  *                    Display 3-bit binary value on RD0-RD2
  * @param n  數值 (0-7) / Value (0-7)
  */
-#define displayBinary3(n) displayBinary3Pins(n, PIN_RD0, PIN_RD1, PIN_RD2)
+#define displayBinary3(n) digitalWriteGroup(PIN_GROUP(D, 0, 3), n)
 
 /**
  * displayBinary4Pins() - 在指定腳位顯示 4 位元二進位值
@@ -1239,17 +1705,3660 @@ bool processSerialReceive() {
  * @param pin2  bit 2 腳位 / bit 2 pin
  * @param pin3  bit 3 (MSB) 腳位 / bit 3 (MSB) pin
  */
-#define displayBinary4Pins(n, pin0, pin1, pin2, pin3) \
-    do {                                              \
-        digitalWrite(pin0, ((n) >> 0) & 1);           \
-        digitalWrite(pin1, ((n) >> 1) & 1);           \
-        digitalWrite(pin2, ((n) >> 2) & 1);           \
-        digitalWrite(pin3, ((n) >> 3) & 1);           \
-    } while (0)
+#define displayBinary4Pins digitalWritePins4  // 直接別名: 腳位參數不可先經過一層巨集展開
 
 /**
  * displayBinary4() - 在 RD0-RD3 顯示 4 位元二進位值
  *                    Display 4-bit binary value on RD0-RD3
  * @param n  數值 (0-15) / Value (0-15)
  */
-#define displayBinary4(n) displayBinary4Pins(n, PIN_RD0, PIN_RD1, PIN_RD2, PIN_RD3)
+#define displayBinary4(n) digitalWriteGroup(PIN_GROUP(D, 0, 4), n)
+
+/* ========== DDS 波形產生器 / Direct Digital Synthesis ========== */
+#pragma region DDS
+/**
+ * 直接數位合成 (DDS) 波形產生器
+ *
+ * 使用 CCP2 PWM (RC1) 輸出，經外部 RC 低通濾波後得到類比波形
+ * - Timer2 設定 PR2 = 63，PWM 為 8 位元解析度 (CCPR2L:DC2B = 0~255)
+ * - 每次 Timer2 後分頻中斷時，相位累加器加上 24 位元調諧字 (tuning word)
+ * - 相位累加器的高 8 位元作為 256 點波形表索引
+ * - 波形表為 const 陣列，XC8 會放在程式記憶體並以 TBLRD 讀取
+ *
+ * 輸出頻率: f = tuningWord × DDS_SAMPLE_RATE / 2^24
+ *
+ * 注意: CCP1 與 CCP2 的 PWM 共用 Timer2，啟用 DDS 後無法同時使用伺服馬達 PWM
+ */
+
+/* Timer2 後分頻比數值 (1-16)，決定取樣率，可在 include 前定義覆蓋 */
+#ifndef DDS_TIMER2_POSTSCALE
+#define DDS_TIMER2_POSTSCALE 4
+#endif
+
+#define DDS_PWM_PR2 63  // 8 位元 PWM 解析度: 4 × (PR2 + 1) = 256 階
+#define DDS_SAMPLE_RATE (_XTAL_FREQ / 4 / (DDS_PWM_PR2 + 1) / DDS_TIMER2_POSTSCALE)  // 取樣率 (Hz)
+
+/**
+ * DDS_TUNING_WORD() - 計算指定頻率的調諧字 (編譯期常數)
+ * @param freq  輸出頻率 (Hz，可為小數)
+ *
+ * 計算公式: tuningWord = freq × 2^24 / DDS_SAMPLE_RATE
+ */
+#define DDS_TUNING_WORD(freq) ((__uint24)((freq) * 16777216.0 / DDS_SAMPLE_RATE))
+
+/* 256 點正弦波形表 (中心值 128，振幅 127) */
+const byte ddsSineTable[256] = {
+    128, 131, 134, 137, 140, 144, 147, 150, 153, 156, 159, 162, 165, 168, 171, 174,
+    177, 179, 182, 185, 188, 191, 193, 196, 199, 201, 204, 206, 209, 211, 213, 216,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 239, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 239, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 216, 213, 211, 209, 206, 204, 201, 199, 196, 193, 191, 188, 185, 182, 179,
+    177, 174, 171, 168, 165, 162, 159, 156, 153, 150, 147, 144, 140, 137, 134, 131,
+    128, 125, 122, 119, 116, 112, 109, 106, 103, 100,  97,  94,  91,  88,  85,  82,
+     79,  77,  74,  71,  68,  65,  63,  60,  57,  55,  52,  50,  47,  45,  43,  40,
+     38,  36,  34,  32,  30,  28,  26,  24,  22,  21,  19,  17,  16,  15,  13,  12,
+     11,  10,   8,   7,   6,   6,   5,   4,   3,   3,   2,   2,   2,   1,   1,   1,
+      1,   1,   1,   1,   2,   2,   2,   3,   3,   4,   5,   6,   6,   7,   8,  10,
+     11,  12,  13,  15,  16,  17,  19,  21,  22,  24,  26,  28,  30,  32,  34,  36,
+     38,  40,  43,  45,  47,  50,  52,  55,  57,  60,  63,  65,  68,  71,  74,  77,
+     79,  82,  85,  88,  91,  94,  97, 100, 103, 106, 109, 112, 116, 119, 122, 125,
+};
+
+/* DDS 狀態 (由 Timer2 中斷更新) */
+__uint24 ddsPhase;                // 相位累加器 (24 位元)
+__uint24 ddsTuningWord;           // 目前使用中的調諧字
+const byte* ddsWaveTable;         // 目前使用中的波形表
+__uint24 ddsPendingTuningWord;    // 最新設定的調諧字 (等待套用或已套用)
+const byte* ddsPendingWaveTable;  // 最新設定的波形表 (等待套用或已套用)
+volatile bool ddsUpdatePending;   // 有新設定等待在下一個取樣時套用
+
+/**
+ * ddsBegin() - 初始化 DDS 輸出 (RC1/CCP2)
+ * @param waveTable  256 點波形表 (如 ddsSineTable)
+ * @param priority   Timer2 中斷優先權 (1=高, 0=低)
+ *
+ * 輸出初始為零頻率 (固定輸出波形表第 0 點)
+ */
+inline void ddsBegin(const byte* waveTable, byte priority) {
+    ddsPhase = 0;
+    ddsTuningWord = 0;
+    ddsWaveTable = waveTable;
+    ddsPendingTuningWord = 0;
+    ddsPendingWaveTable = waveTable;
+    ddsUpdatePending = false;
+
+    pinMode(PIN_RC1, PIN_OUTPUT);
+    PR2 = DDS_PWM_PR2;
+    CCP2CONbits.DC2B = waveTable[0] & 0b11;
+    CCPR2L = waveTable[0] >> 2;
+    setCCP2Mode(ECCP_MODE_PWM_HH);
+    enableTimer2(TIMER2_PRESCALE_1, DDS_TIMER2_POSTSCALE - 1);
+    enableInterrupt_Timer2PR2(priority);
+}
+
+/**
+ * ddsSet() - 同時設定調諧字與波形表
+ * @param tuningWord  24 位元調諧字 (見 DDS_TUNING_WORD)
+ * @param waveTable   256 點波形表
+ *
+ * 新設定先寫入暫存區，由下一次取樣中斷一次套用
+ * 相位累加器不重設，因此切換頻率或波形時輸出相位連續，不會產生突波
+ * 寫入期間先清除旗標，中斷不會讀到寫一半的設定，呼叫端不需等待
+ */
+void ddsSet(__uint24 tuningWord, const byte* waveTable) {
+    ddsUpdatePending = false;
+    ddsPendingTuningWord = tuningWord;
+    ddsPendingWaveTable = waveTable;
+    ddsUpdatePending = true;
+}
+
+/* 另一欄位取自暫存區 (最新設定)，連續呼叫時前一次尚未套用的設定不會遺失 */
+#define ddsSetTuningWord(tuningWord) ddsSet(tuningWord, ddsPendingWaveTable)  // 只改變頻率
+#define ddsSetWaveform(waveTable) ddsSet(ddsPendingTuningWord, waveTable)     // 只改變波形
+
+/**
+ * ddsSetFrequency() - 設定輸出頻率 (編譯期常數)
+ * @param freq  輸出頻率 (Hz)，必須小於取樣率的一半
+ */
+#define ddsSetFrequency(freq)                                                                  \
+    _Static_assert((uint32_t)((freq) * 2) < DDS_SAMPLE_RATE, "Frequency above Nyquist limit"); \
+    ddsSetTuningWord(DDS_TUNING_WORD(freq))
+
+/**
+ * processDDS() - 處理 DDS 取樣 (在 Timer2 中斷中呼叫)
+ * @return  true = 已處理 Timer2 中斷, false = 非 Timer2 中斷
+ *
+ * 每次取樣: 套用等待中的設定 → 累加相位 → 查表 → 寫入 CCPR2L/DC2B
+ */
+bool processDDS() {
+    if (!interruptByTimer2PR2())
+        return false;
+    if (ddsUpdatePending) {
+        ddsTuningWord = ddsPendingTuningWord;
+        ddsWaveTable = ddsPendingWaveTable;
+        ddsUpdatePending = false;
+    }
+    ddsPhase += ddsTuningWord;
+    byte value = ddsWaveTable[(byte)(ddsPhase >> 16)];
+    CCP2CONbits.DC2B = value & 0b11;  // 低 2 位
+    CCPR2L = value >> 2;              // 高 6 位
+    clearInterrupt_Timer2PR2();
+    return true;
+}
+#pragma endregion DDS
+
+/* ========== 音調與旋律播放 / Tone & Melody Player ========== */
+#pragma region Tone
+/**
+ * 使用 CCP2 比較模式 (ECCP_MODE_COMPARE_TOM) 產生方波音調
+ *
+ * - CCP2 以 Timer3 為時基 (T3CCP2:T3CCP1 = 01，CCP1 仍使用 Timer1)
+ * - TMR3 與 CCPR2 相符時由硬體切換 RC1 輸出，波形邊緣不受中斷延遲影響
+ * - CCP2 中斷只需將 CCPR2 加上半週期計數，不需忙碌等待或軟體切換腳位
+ *
+ * 半週期計數 = FOSC / 4 / TONE_TIMER3_PRESCALE / (2 × freq)
+ *
+ * 注意: 與 DDS 同樣使用 RC1/CCP2，兩者不可同時使用
+ */
+
+/* Timer3 預分頻比數值，確保 20 Hz 的半週期計數不超過 65535 */
+#ifndef TONE_TIMER3_PRESCALE
+#if (_XTAL_FREQ > 20000000)
+#define TONE_TIMER3_PRESCALE 8
+#elif (_XTAL_FREQ > 10000000)
+#define TONE_TIMER3_PRESCALE 4
+#else
+#define TONE_TIMER3_PRESCALE 1
+#endif
+#endif
+
+#if (TONE_TIMER3_PRESCALE == 1)
+#define _TONE_TIMER3_PRESCALE_BITS TIMER3_PRESCALE_1
+#elif (TONE_TIMER3_PRESCALE == 2)
+#define _TONE_TIMER3_PRESCALE_BITS TIMER3_PRESCALE_2
+#elif (TONE_TIMER3_PRESCALE == 4)
+#define _TONE_TIMER3_PRESCALE_BITS TIMER3_PRESCALE_4
+#elif (TONE_TIMER3_PRESCALE == 8)
+#define _TONE_TIMER3_PRESCALE_BITS TIMER3_PRESCALE_8
+#else
+#error 不合法的 "TONE_TIMER3_PRESCALE"，只能為 1, 2, 4, 8
+#endif
+
+#define TONE_TIMER_CLOCK (_XTAL_FREQ / 4 / TONE_TIMER3_PRESCALE)  // Timer3 計數頻率 (Hz)
+
+/**
+ * TONE_HALF_PERIOD() - 計算指定頻率的半週期計數 (編譯期常數)
+ * @param freq  音調頻率 (Hz)
+ */
+#define TONE_HALF_PERIOD(freq) ((uint16_t)(TONE_TIMER_CLOCK / 2.0 / (freq) + 0.5))
+
+/**
+ * 旋律音符，存放於程式記憶體的 const 陣列
+ * halfPeriod = 0 表示休止符
+ */
+typedef struct {
+    uint16_t halfPeriod;  // 半週期計數 (TONE_HALF_PERIOD)
+    uint16_t ticks;       // 持續時間 (melodyTick() 呼叫次數，0 與 1 相同)
+} ToneNote;
+
+#define TONE_NOTE(freq, ticks) {TONE_HALF_PERIOD(freq), ticks}  // 音符
+#define TONE_REST(ticks) {0, ticks}                             // 休止符
+
+/* 音調狀態 */
+uint16_t toneHalfPeriod;  // 目前半週期計數，0 = 停止
+
+/* 旋律狀態 */
+const ToneNote* melodyNotes;  // 旋律音符表
+byte melodyLength;            // 音符數量
+byte melodyIndex;             // 目前音符索引
+uint16_t melodyTicksLeft;     // 目前音符剩餘時間
+bool melodyLoop;              // 結束後是否重新播放
+volatile bool melodyPlaying;  // 是否播放中
+
+/**
+ * toneBegin() - 初始化音調輸出 (RC1/CCP2 + Timer3)
+ * @param priority  CCP2 中斷優先權 (1=高, 0=低)
+ */
+inline void toneBegin(byte priority) {
+    toneHalfPeriod = 0;
+    melodyPlaying = false;
+    pinMode(PIN_RC1, PIN_OUTPUT);
+    digitalWrite(PIN_RC1, 0);
+
+    setCCPTimerSource(CCP_TIMER_SOURCE_T1_T3);  // CCP2 使用 Timer3
+    T3CONbits.RD16 = 1;                         // 16 位元讀寫模式
+    enableTimer3(_TONE_TIMER3_PRESCALE_BITS);
+
+    IPR2bits.CCP2IP = priority;  // 設定中斷優先權
+}
+
+/**
+ * toneStartHalfPeriod() - 以半週期計數開始或變更音調
+ * @param halfPeriod  半週期計數 (TONE_HALF_PERIOD)，0 = 停止
+ *
+ * 不會阻塞: 已在發聲時只更新半週期，由下一次比較中斷套用
+ */
+void toneStartHalfPeriod(uint16_t halfPeriod) {
+    if (!halfPeriod) {
+        disableInterrupt_CCP2();
+        setCCP2Mode(ECCP_MODE_OFF);  // 釋放腳位給 LATC
+        toneHalfPeriod = 0;
+        return;
+    }
+    disableInterrupt_CCP2();  // 更新 16 位元半週期期間暫停 CCP2 中斷
+    if (!toneHalfPeriod) {
+        CCPR2 = TMR3 + halfPeriod;
+        setCCP2Mode(ECCP_MODE_COMPARE_TOM);
+        clearInterrupt_CCP2();
+    }
+    toneHalfPeriod = halfPeriod;
+    PIE2bits.CCP2IE = 0b1;
+}
+
+/**
+ * toneStart() - 以頻率開始音調
+ * @param freq  音調頻率 (Hz)，需 >= TONE_TIMER_CLOCK / 131072
+ */
+#define toneStart(freq) toneStartHalfPeriod((uint16_t)(TONE_TIMER_CLOCK / 2 / (freq)))
+
+#define toneStop() toneStartHalfPeriod(0)  // 停止音調
+
+/**
+ * processTone() - 處理 CCP2 比較中斷 (在中斷中呼叫)
+ * @return  true = 已處理 CCP2 中斷, false = 非 CCP2 中斷
+ */
+bool processTone() {
+    if (!PIE2bits.CCP2IE || !interruptByCCP2())
+        return false;
+    CCPR2 += toneHalfPeriod;  // 硬體已切換腳位，設定下一次切換時間
+    clearInterrupt_CCP2();
+    return true;
+}
+
+/**
+ * melodyPlay() - 開始播放旋律
+ * @param notes   音符表 (const ToneNote 陣列)
+ * @param length  音符數量 (0 = 不播放，只停止目前的旋律)
+ * @param loop    播放完畢後是否重新開始
+ */
+void melodyPlay(const ToneNote* notes, byte length, bool loop) {
+    melodyPlaying = false;
+    if (!length) {
+        toneStop();
+        return;
+    }
+    melodyNotes = notes;
+    melodyLength = length;
+    melodyLoop = loop;
+    melodyIndex = 0;
+    melodyTicksLeft = notes[0].ticks;
+    toneStartHalfPeriod(notes[0].halfPeriod);
+    melodyPlaying = true;
+}
+
+/**
+ * melodyStop() - 停止播放旋律
+ */
+#define melodyStop()       \
+    melodyPlaying = false; \
+    toneStop()
+
+/**
+ * melodyTick() - 旋律節拍 (在固定週期的計時器中斷中呼叫)
+ *
+ * 每次呼叫將目前音符剩餘時間減一，時間到時切換到下一個音符
+ * ticks = 0 的音符不遞減 (避免繞回 65535)，與 1 相同在下一個節拍切換
+ */
+void melodyTick() {
+    if (!melodyPlaying || (melodyTicksLeft && --melodyTicksLeft))
+        return;
+    if (++melodyIndex >= melodyLength) {
+        if (!melodyLoop) {
+            melodyStop();
+            return;
+        }
+        melodyIndex = 0;
+    }
+    melodyTicksLeft = melodyNotes[melodyIndex].ticks;
+    toneStartHalfPeriod(melodyNotes[melodyIndex].halfPeriod);
+}
+#pragma endregion Tone
+
+/* ========== 協同式排程器 / Cooperative Scheduler ========== */
+#pragma region Scheduler
+/**
+ * 以 Timer0 節拍驅動的協同式排程器
+ *
+ * - 固定大小的任務表，每個任務有自己的週期與相位偏移 (單位: 節拍)
+ * - Timer0 中斷只遞減倒數計數並設定到期位元遮罩，不執行任務
+ * - 主迴圈呼叫 schedulerRun() 依到期遮罩執行任務
+ * - 任務尚未執行又再次到期時記錄為超時 (overrun)
+ *
+ * 任務索引即為優先順序: 同一節拍到期時索引小的任務先執行
+ */
+
+/* 任務數量上限 (1-8，到期遮罩為 1 個位元組)，可在 include 前定義覆蓋 */
+#ifndef SCHEDULER_MAX_TASKS
+#define SCHEDULER_MAX_TASKS 8
+#endif
+
+/* 節拍週期 (微秒 µs) 與 Timer0 預分頻比數值，可在 include 前定義覆蓋 */
+#ifndef SCHEDULER_TICK_PERIOD
+#define SCHEDULER_TICK_PERIOD 1000
+#endif
+#ifndef SCHEDULER_TIMER0_PRESCALE
+#define SCHEDULER_TIMER0_PRESCALE 2
+#endif
+
+#if (SCHEDULER_MAX_TASKS > 8)
+#error "SCHEDULER_MAX_TASKS" 不可超過 8
+#endif
+
+typedef struct {
+    void (*run)(void);   // 任務函式，NULL = 未使用
+    uint16_t period;     // 執行週期 (節拍)
+    uint16_t countdown;  // 距離下次到期的節拍數
+    byte overruns;       // 超時次數 (飽和於 255)
+} SchedulerTask;
+
+SchedulerTask schedulerTasks[SCHEDULER_MAX_TASKS];  // 任務表
+volatile byte schedulerDueMask;                     // 已到期待執行的任務位元遮罩
+volatile byte schedulerOverrunMask;                 // 曾經超時的任務位元遮罩
+volatile uint16_t schedulerTicks;                   // 節拍計數 (溢位循環)
+byte schedulerRunPending;                           // schedulerRun() 本次取走但尚未執行的任務位元遮罩
+
+/**
+ * schedulerBegin() - 啟動 Timer0 節拍
+ * @param priority  Timer0 中斷優先權 (1=高, 0=低)
+ *
+ * Timer0 設為 16 位元模式，週期為 SCHEDULER_TICK_PERIOD
+ */
+#define schedulerBegin(priority)                                                                          \
+    enableTimer0(MACRO_CODE_XCONCAT(TIMER0_PRESCALE_, SCHEDULER_TIMER0_PRESCALE), TIMER0_PRESCALE_ENABLE, \
+                 TIMER0_CLOCK_SOURCE_INTERNAL, TIMER0_MODE_16BIT);                                        \
+    setTimer0InterruptPeriod16(SCHEDULER_TICK_PERIOD, SCHEDULER_TIMER0_PRESCALE);                         \
+    enableInterrupt_Timer0Overflow(priority)
+
+/**
+ * schedulerAddTask() - 設定任務表項目
+ * @param index   任務索引 (0 ~ SCHEDULER_MAX_TASKS-1)，同時為優先順序
+ * @param task    任務函式
+ * @param period  執行週期 (節拍)，0 = 停用
+ * @param offset  相位偏移 (節拍，需小於 period)，用於錯開同週期的任務
+ */
+void schedulerAddTask(byte index, void (*task)(void), uint16_t period, uint16_t offset) {
+    byte mask = (byte)(1 << index);
+    byte interruptEnable = INTCONbits.TMR0IE;
+    INTCONbits.TMR0IE = 0b0;
+    schedulerTasks[index].run = task;
+    schedulerTasks[index].period = period;
+    schedulerTasks[index].countdown = offset ? offset : period;
+    schedulerTasks[index].overruns = 0;
+    schedulerDueMask &= (byte)~mask;
+    schedulerOverrunMask &= (byte)~mask;
+    schedulerRunPending &= (byte)~mask;  // 由其他任務更改時，本次不再執行
+    INTCONbits.TMR0IE = interruptEnable;
+}
+
+#define schedulerRemoveTask(index) schedulerAddTask(index, NULL, 0, 0)  // 停用任務
+
+/**
+ * processScheduler() - 處理 Timer0 節拍 (在中斷中呼叫)
+ * @return  true = 已處理 Timer0 中斷, false = 非 Timer0 中斷
+ *
+ * 每個節拍的工作量固定: 遍歷 SCHEDULER_MAX_TASKS 個任務各遞減一次
+ */
+bool processScheduler() {
+    if (!interruptByTimer0Overflow())
+        return false;
+    addTimer0InterruptPeriod16(SCHEDULER_TICK_PERIOD, SCHEDULER_TIMER0_PRESCALE);  // 累加重載，中斷延遲不累積 (預分頻器遺失的週期仍會累積)
+    clearInterrupt_Timer0Overflow();
+    schedulerTicks++;
+
+    SchedulerTask* task = schedulerTasks;
+    byte mask = 1;
+    for (byte i = 0; i < SCHEDULER_MAX_TASKS; i++, task++, mask <<= 1) {
+        if (!task->period || --task->countdown)
+            continue;
+        task->countdown = task->period;
+        if (schedulerDueMask & mask) {
+            // 上一次到期尚未執行: 超時
+            schedulerOverrunMask |= mask;
+            if (task->overruns != 0xFF)
+                task->overruns++;
+        }
+        schedulerDueMask |= mask;
+    }
+    return true;
+}
+
+/**
+ * schedulerRun() - 執行所有已到期任務 (在主迴圈中呼叫)
+ * @return  本次執行的任務位元遮罩，0 = 沒有任務到期
+ *
+ * 一次取走到期遮罩，之後依位元順序執行，不需搜尋任務表
+ * 任務在執行中以 schedulerAddTask() / schedulerRemoveTask() 更改其他已到期的任務時，該任務本次不執行
+ */
+byte schedulerRun() {
+    byte interruptEnable = INTCONbits.TMR0IE;
+    INTCONbits.TMR0IE = 0b0;
+    byte due = schedulerDueMask;
+    schedulerDueMask = 0;
+    INTCONbits.TMR0IE = interruptEnable;
+
+    schedulerRunPending = due;
+    SchedulerTask* task = schedulerTasks;
+    for (byte mask = 1; schedulerRunPending; mask <<= 1, task++) {
+        if (schedulerRunPending & mask) {
+            schedulerRunPending &= (byte)~mask;
+            if (task->run)
+                task->run();
+        }
+    }
+    return due;
+}
+
+#define schedulerTaskOverruns(index) schedulerTasks[index].overruns  // 取得任務超時次數
+#pragma endregion Scheduler
+
+/* ========== 系統時間 / Monotonic Clock ========== */
+#pragma region Clock
+/**
+ * 以 Timer1 自由計數加上軟體溢位計數組成的 32 位元時間基準
+ *
+ * - Timer1 不重新載入，預分頻比使每個計數為 1µs (FOSC >= 4MHz) 或 2^n µs
+ * - Timer1 溢位中斷將溢位計數加一，並累加微秒數與毫秒數
+ * - 讀取 TMR1 時使用 RD16 模式: 讀取 TMR1L 時同時鎖存 TMR1H
+ * - micros() 只有移位、加法與比較，不含乘除；未啟用 CLOCK_SCALING 時移位量為編譯期常數
+ * - setClockProfile() 無法以預分頻比維持計數頻率時，先累加目前計數再以新的 2^n µs 重新計數
+ *
+ * 注意: Timer1 由時間基準獨佔，不可再使用 setTimer1InterruptPeriod()
+ */
+
+/* 依 _XTAL_FREQ 選擇 Timer1 預分頻比與計數對應的微秒位移 */
+#if (_XTAL_FREQ == 32000000)
+#define CLOCK_TIMER1_PRESCALE 8
+#define CLOCK_MICROS_SHIFT 0
+#elif (_XTAL_FREQ == 16000000)
+#define CLOCK_TIMER1_PRESCALE 4
+#define CLOCK_MICROS_SHIFT 0
+#elif (_XTAL_FREQ == 8000000)
+#define CLOCK_TIMER1_PRESCALE 2
+#define CLOCK_MICROS_SHIFT 0
+#elif (_XTAL_FREQ == 4000000)
+#define CLOCK_TIMER1_PRESCALE 1
+#define CLOCK_MICROS_SHIFT 0
+#elif (_XTAL_FREQ == 2000000)
+#define CLOCK_TIMER1_PRESCALE 1
+#define CLOCK_MICROS_SHIFT 1
+#elif (_XTAL_FREQ == 1000000)
+#define CLOCK_TIMER1_PRESCALE 1
+#define CLOCK_MICROS_SHIFT 2
+#elif (_XTAL_FREQ == 500000)
+#define CLOCK_TIMER1_PRESCALE 1
+#define CLOCK_MICROS_SHIFT 3
+#elif (_XTAL_FREQ == 250000)
+#define CLOCK_TIMER1_PRESCALE 1
+#define CLOCK_MICROS_SHIFT 4
+#elif (_XTAL_FREQ == 125000)
+#define CLOCK_TIMER1_PRESCALE 1
+#define CLOCK_MICROS_SHIFT 5
+#endif
+/* 31 kHz 的計數週期無法以 2^n µs 表示，不提供系統時間 */
+
+#ifdef CLOCK_TIMER1_PRESCALE
+#define CLOCK_OVERFLOW_US (65536UL << CLOCK_MICROS_SHIFT)     // 每次溢位經過的微秒數
+#define CLOCK_OVERFLOW_MS (CLOCK_OVERFLOW_US / 1000)          // 每次溢位的整數毫秒
+#define CLOCK_OVERFLOW_US_REM (CLOCK_OVERFLOW_US % 1000)      // 每次溢位的剩餘微秒
+
+volatile uint16_t clockOverflows;      // Timer1 溢位次數 (讀取時判斷是否被中斷更新)
+volatile uint32_t clockMicros;         // 至上次溢位為止的微秒數
+volatile uint32_t clockMillis;         // 至上次溢位為止的毫秒數
+volatile uint16_t clockMillisRemain;   // 至上次溢位為止不足 1ms 的微秒數 (0-999)
+
+#ifdef CLOCK_SCALING
+byte clockMicrosShift = CLOCK_MICROS_SHIFT;            // 每個計數的微秒位移 (setClockProfile() 更新)
+uint32_t clockOverflowUs = CLOCK_OVERFLOW_US;          // 每次溢位經過的微秒數
+uint16_t clockOverflowMs = CLOCK_OVERFLOW_MS;          // 每次溢位的整數毫秒
+uint16_t clockOverflowUsRem = CLOCK_OVERFLOW_US_REM;   // 每次溢位的剩餘微秒
+#else
+/* 未啟用 CLOCK_SCALING: 移位與溢位量為編譯期常數 */
+#define clockMicrosShift CLOCK_MICROS_SHIFT
+#define clockOverflowUs CLOCK_OVERFLOW_US
+#define clockOverflowMs CLOCK_OVERFLOW_MS
+#define clockOverflowUsRem CLOCK_OVERFLOW_US_REM
+#endif
+
+/**
+ * clockBegin() - 啟動系統時間
+ * @param priority  Timer1 溢位中斷優先權 (1=高, 0=低)
+ */
+#define clockBegin(priority)                                                   \
+    clockOverflows = 0;                                                        \
+    clockMicros = 0;                                                           \
+    clockMillis = 0;                                                           \
+    clockMillisRemain = 0;                                                     \
+    _timer1FreeRunning();                                                      \
+    TMR1 = 0;                                                                  \
+    enableTimer1(MACRO_CODE_XCONCAT(TIMER1_PRESCALE_, CLOCK_TIMER1_PRESCALE)); \
+    enableInterrupt_Timer1Overflow(priority)
+
+/**
+ * processClock() - 處理 Timer1 溢位 (在中斷中呼叫)
+ * @return  true = 已處理 Timer1 中斷, false = 非 Timer1 中斷
+ */
+bool processClock() {
+    if (!interruptByTimer1Overflow())
+        return false;
+    clearInterrupt_Timer1Overflow();
+    clockOverflows++;
+    clockMicros += clockOverflowUs;
+    clockMillis += clockOverflowMs;
+    clockMillisRemain += clockOverflowUsRem;
+    if (clockMillisRemain >= 1000) {
+        clockMillisRemain -= 1000;
+        clockMillis++;
+    }
+    return true;
+}
+
+#ifdef CLOCK_SCALING
+/**
+ * _clockRescale() - 累加目前計數後以新的微秒位移重新計數 (setClockProfile() 在關閉中斷時呼叫)
+ * @param shift  新的每個計數微秒位移
+ */
+void _clockRescale(byte shift) {
+    uint16_t low = TMR1;
+    if (processClock() && (low & 0x8000))
+        low = 0;  // 讀取後才溢位: 讀到的計數已包含在溢位中
+    TMR1 = 0;
+    uint32_t us = (uint32_t)low << clockMicrosShift;
+    clockOverflows++;
+    clockMicros += us;
+    clockMillis += us / 1000;
+    clockMillisRemain += (uint16_t)(us % 1000);
+    if (clockMillisRemain >= 1000) {
+        clockMillisRemain -= 1000;
+        clockMillis++;
+    }
+    clockMicrosShift = shift;
+    clockOverflowUs = 65536UL << shift;
+    clockOverflowMs = (uint16_t)(clockOverflowUs / 1000);
+    clockOverflowUsRem = (uint16_t)(clockOverflowUs % 1000);
+}
+#endif
+
+/**
+ * micros() - 取得開機後經過的微秒數
+ * @return  32 位元微秒數 (約 71.6 分鐘循環一次)
+ *
+ * 讀取期間若溢位中斷更新了溢位計數則重讀
+ * 若溢位已發生但中斷尚未執行 (中斷關閉或位於更高優先權中斷)，以 TMR1IF 補正
+ *
+ * 執行時間 (未重讀，含呼叫與返回): FOSC >= 4MHz (移位 0) 約 50 個指令週期，每多 1 位移位約加 10 個；
+ * 啟用 CLOCK_SCALING 時改為執行期移位迴圈，約 60 ~ 120 個。實際數字以 .lst 為準
+ */
+uint32_t micros() {
+    uint32_t us;
+    uint16_t high;
+    uint16_t low;
+    bool pending;
+    do {
+        high = clockOverflows;
+        us = clockMicros;
+        low = TMR1;  // RD16: 讀取 TMR1L 同時鎖存 TMR1H
+        pending = interruptByTimer1Overflow();
+    } while (high != clockOverflows);
+    us += (uint32_t)low << clockMicrosShift;
+    if (pending && !(low & 0x8000))
+        us += clockOverflowUs;
+    return us;
+}
+
+/**
+ * millis() - 取得開機後經過的毫秒數
+ * @return  32 位元毫秒數
+ *
+ * 溢位中斷已累加整數毫秒，讀取時只需換算不足一次溢位的部分
+ * 以移位取代 ÷1000 (1/1024 + 1/65536 + 1/131072 ≈ 0.99945/1000)，不需 32 位元乘除
+ * 結果只會落後、不會超前，且保證單調遞增；換算部分最多落後約 3ms (FOSC >= 500kHz) 至 5ms (125kHz)
+ * 需要精確毫秒時以 micros() 計算
+ *
+ * 執行時間約為 micros() 再加 40 個指令週期 (換算只用 16 位元移位)
+ */
+uint32_t millis() {
+    uint32_t ms;
+    uint32_t us;
+    uint16_t high;
+    uint16_t low;
+    bool pending;
+    do {
+        high = clockOverflows;
+        ms = clockMillis;
+        us = clockMillisRemain;
+        low = TMR1;
+        pending = interruptByTimer1Overflow();
+    } while (high != clockOverflows);
+    us += (uint32_t)low << clockMicrosShift;
+    if (pending && !(low & 0x8000))
+        us += clockOverflowUs;
+    uint16_t t = (uint16_t)(us >> 10);  // 最大約 4100 (125kHz)，16 位元足夠
+    uint16_t t64 = t >> 6;
+    return ms + t + t64 + (t64 >> 1);
+}
+#endif
+#pragma endregion Clock
+
+/* ========== 軟體計時器 / Software Timers ========== */
+#pragma region SoftTimer
+/**
+ * 靜態記憶體池配置的單次/週期軟體計時器 (不使用 heap)
+ *
+ * - 計時器節點來自固定大小的陣列，以索引作為控制代碼
+ * - 執行中的計時器以差值串列 (delta list) 依到期順序排列，
+ *   每個節點只記錄與前一個節點的節拍差
+ * - 每個節拍只需遞減串列第一個節點，與執行中的計時器數量無關
+ * - 回呼可在節拍中斷中直接執行，或延後到主迴圈的 softTimerRun() 執行
+ *
+ * softTimerTick() 需由固定週期的中斷 (或排程器任務) 呼叫，節拍單位由呼叫週期決定
+ */
+
+/* 計時器數量上限 (1-254)，可在 include 前定義覆蓋 */
+#ifndef SOFT_TIMER_POOL_SIZE
+#define SOFT_TIMER_POOL_SIZE 8
+#endif
+
+#define SOFT_TIMER_NONE 0xFF  // 無效的計時器代碼
+
+/* 計時器模式 (softTimerCreate 的 mode 參數，可用 | 組合) */
+#define SOFT_TIMER_ONE_SHOT 0b0000  // 單次: 到期後停止
+#define SOFT_TIMER_PERIODIC 0b0001  // 週期: 到期後以相同節拍數重新啟動
+#define SOFT_TIMER_DEFERRED 0b0010  // 延後: 回呼在主迴圈 softTimerRun() 中執行
+
+/* 內部狀態旗標 */
+#define _SOFT_TIMER_ALLOCATED 0b0100  // 已配置
+#define _SOFT_TIMER_ACTIVE 0b1000     // 位於差值串列中
+#define _SOFT_TIMER_PENDING 0b10000   // 已到期，等待主迴圈執行回呼
+
+/**
+ * 軟體計時器保護區段
+ * 預設暫停全域中斷，若 softTimerTick() 只由單一中斷來源呼叫，可在 include 前改為只遮罩該來源
+ */
+#ifndef SOFT_TIMER_LOCK
+#define SOFT_TIMER_LOCK()                \
+    byte _softTimerGIE = INTCONbits.GIE; \
+    INTCONbits.GIE = 0b0
+#define SOFT_TIMER_UNLOCK() INTCONbits.GIE = _softTimerGIE
+#endif
+
+typedef struct {
+    uint16_t delta;         // 與前一個節點的節拍差
+    uint16_t period;        // 啟動時的節拍數 (週期模式重新啟動用)
+    void (*callback)(void); // 到期回呼
+    byte next;              // 差值串列中的下一個節點
+    byte flags;             // 模式與狀態旗標
+} SoftTimerNode;
+
+#define _SOFT_TIMER_DEFERRED_SIZE (SOFT_TIMER_POOL_SIZE + 1)  // 延後佇列多一格，head == tail 只代表空佇列
+
+SoftTimerNode softTimerPool[SOFT_TIMER_POOL_SIZE];     // 計時器記憶體池
+byte softTimerHead = SOFT_TIMER_NONE;                  // 差值串列第一個節點
+byte softTimerDeferred[_SOFT_TIMER_DEFERRED_SIZE];     // 等待主迴圈執行的計時器佇列
+volatile byte softTimerDeferredHead;                   // 佇列讀取位置
+volatile byte softTimerDeferredTail;                   // 佇列寫入位置
+
+/**
+ * softTimerCreate() - 從記憶體池配置計時器
+ * @param callback  到期回呼
+ * @param mode      模式 (SOFT_TIMER_ONE_SHOT / PERIODIC，可再 | SOFT_TIMER_DEFERRED)
+ * @return          計時器代碼，記憶體池已滿時回傳 SOFT_TIMER_NONE
+ */
+byte softTimerCreate(void (*callback)(void), byte mode) {
+    for (byte i = 0; i < SOFT_TIMER_POOL_SIZE; i++) {
+        if (softTimerPool[i].flags & (_SOFT_TIMER_ALLOCATED | _SOFT_TIMER_PENDING))
+            continue;  // 已釋放但延後回呼尚未取出的節點暫不重用
+        softTimerPool[i].callback = callback;
+        softTimerPool[i].flags = mode | _SOFT_TIMER_ALLOCATED;
+        return i;
+    }
+    return SOFT_TIMER_NONE;
+}
+
+/* 將節點依到期時間插入差值串列 (需在保護區段中呼叫) */
+void _softTimerInsert(byte id, uint16_t ticks) {
+    byte* link = &softTimerHead;
+    byte cur = softTimerHead;
+    while (cur != SOFT_TIMER_NONE && softTimerPool[cur].delta <= ticks) {
+        ticks -= softTimerPool[cur].delta;
+        link = &softTimerPool[cur].next;
+        cur = *link;
+    }
+    softTimerPool[id].delta = ticks;
+    softTimerPool[id].next = cur;
+    if (cur != SOFT_TIMER_NONE)
+        softTimerPool[cur].delta -= ticks;
+    *link = id;
+    softTimerPool[id].flags |= _SOFT_TIMER_ACTIVE;
+}
+
+/* 將節點從差值串列移除，剩餘節拍差併入下一個節點 (需在保護區段中呼叫) */
+void _softTimerRemove(byte id) {
+    byte* link = &softTimerHead;
+    while (*link != id)
+        link = &softTimerPool[*link].next;
+    *link = softTimerPool[id].next;
+    if (*link != SOFT_TIMER_NONE)
+        softTimerPool[*link].delta += softTimerPool[id].delta;
+    softTimerPool[id].flags &= (byte)~_SOFT_TIMER_ACTIVE;
+}
+
+/**
+ * softTimerStart() - 啟動或重新啟動計時器
+ * @param id     計時器代碼
+ * @param ticks  到期節拍數 (最小為 1)，週期模式同時為週期
+ *
+ * 已在執行中的計時器會重新開始計時
+ */
+void softTimerStart(byte id, uint16_t ticks) {
+    if (!ticks)
+        ticks = 1;
+    SOFT_TIMER_LOCK();
+    if (softTimerPool[id].flags & _SOFT_TIMER_ACTIVE)
+        _softTimerRemove(id);
+    softTimerPool[id].period = ticks;
+    _softTimerInsert(id, ticks);
+    SOFT_TIMER_UNLOCK();
+}
+
+/**
+ * softTimerStop() - 停止計時器 (尚未執行的延後回呼仍會執行)
+ * @param id  計時器代碼
+ */
+void softTimerStop(byte id) {
+    SOFT_TIMER_LOCK();
+    if (softTimerPool[id].flags & _SOFT_TIMER_ACTIVE)
+        _softTimerRemove(id);
+    SOFT_TIMER_UNLOCK();
+}
+
+/**
+ * softTimerFree() - 停止計時器並歸還記憶體池
+ * @param id  計時器代碼
+ */
+void softTimerFree(byte id) {
+    softTimerStop(id);
+    softTimerPool[id].flags &= _SOFT_TIMER_PENDING;  // 保留待執行旗標直到佇列取出
+}
+
+#define softTimerActive(id) (softTimerPool[id].flags & _SOFT_TIMER_ACTIVE)  // 計時器是否執行中
+
+/**
+ * softTimerTick() - 軟體計時器節拍 (在固定週期的中斷中呼叫)
+ *
+ * 只遞減串列第一個節點，接著取出所有節拍差為 0 的節點
+ */
+void softTimerTick() {
+    byte id = softTimerHead;
+    if (id == SOFT_TIMER_NONE)
+        return;
+    softTimerPool[id].delta--;
+    while (id != SOFT_TIMER_NONE && !softTimerPool[id].delta) {
+        SoftTimerNode* node = &softTimerPool[id];
+        softTimerHead = node->next;
+        node->flags &= (byte)~_SOFT_TIMER_ACTIVE;
+        if (node->flags & SOFT_TIMER_PERIODIC)
+            _softTimerInsert(id, node->period);
+
+        if (!(node->flags & SOFT_TIMER_DEFERRED)) {
+            node->callback();
+        } else if (!(node->flags & _SOFT_TIMER_PENDING)) {
+            // 每個計時器在佇列中最多一筆 (PENDING)，最多 SOFT_TIMER_POOL_SIZE 筆，佇列多一格不會寫滿
+            node->flags |= _SOFT_TIMER_PENDING;
+            softTimerDeferred[softTimerDeferredTail] = id;
+            softTimerDeferredTail = softTimerDeferredTail + 1 == _SOFT_TIMER_DEFERRED_SIZE ? 0 : softTimerDeferredTail + 1;
+        }
+        id = softTimerHead;
+    }
+}
+
+/**
+ * softTimerAdvance() - 一次推進多個節拍 (無節拍中斷的省電模式使用)
+ * @param ticks  經過的節拍數
+ *
+ * 直接扣除第一個節點的節拍差，只有到期的計時器需要處理
+ * 需在保護區段外呼叫，且不可與 softTimerTick() 同時使用
+ */
+void softTimerAdvance(uint16_t ticks) {
+    while (ticks && softTimerHead != SOFT_TIMER_NONE) {
+        SoftTimerNode* head = &softTimerPool[softTimerHead];
+        if (head->delta > ticks) {
+            head->delta -= ticks;
+            return;
+        }
+        ticks -= head->delta;
+        head->delta = 1;
+        softTimerTick();
+    }
+}
+
+#define softTimerTicksToNext() (softTimerHead == SOFT_TIMER_NONE ? 0xFFFF : softTimerPool[softTimerHead].delta)  // 距離最近到期的節拍數
+
+/**
+ * softTimerRun() - 執行已到期的延後回呼 (在主迴圈中呼叫)
+ */
+void softTimerRun() {
+    while (softTimerDeferredHead != softTimerDeferredTail) {
+        SoftTimerNode* node = &softTimerPool[softTimerDeferred[softTimerDeferredHead]];
+        softTimerDeferredHead = softTimerDeferredHead + 1 == _SOFT_TIMER_DEFERRED_SIZE ? 0 : softTimerDeferredHead + 1;
+        SOFT_TIMER_LOCK();
+        node->flags &= (byte)~_SOFT_TIMER_PENDING;
+        byte allocated = node->flags & _SOFT_TIMER_ALLOCATED;
+        SOFT_TIMER_UNLOCK();
+        if (allocated)
+            node->callback();
+    }
+}
+#pragma endregion SoftTimer
+
+/* ========== 電源管理 / Power Management ========== */
+#pragma region Power
+/**
+ * IDLE / SLEEP 省電模式與喚醒管理 (需要系統時間 clockBegin)
+ *
+ * - IDLE (OSCCON.IDLEN = 1): CPU 停止，周邊與 Timer1 持續運作，任何已啟用的中斷都會喚醒
+ * - SLEEP (OSCCON.IDLEN = 0): 振盪器停止，只能由 INT0/1/2、RB 狀態改變、UART 接收 (WUE) 等喚醒
+ *   睡眠期間 Timer1 停止，系統時間不前進；睡眠時間以 WDT 逾時次數估算 (WDT 在睡眠中逾時只喚醒、不重設)
+ * - powerIdleUntil() 以 CCP1 比較模式 (ECCP_MODE_COMPARE_RIO) 在 Timer1 上設定下一次喚醒時間，
+ *   不需固定節拍中斷，CPU 可一路停在 IDLE 直到最近的到期時間
+ * - 統計各狀態的時間，用於計算工作週期與平均電流
+ *
+ * 注意: powerIdleUntil() 使用 CCP1，與 CCP1 PWM (伺服馬達) 不可同時使用
+ */
+#ifdef CLOCK_TIMER1_PRESCALE
+
+/* WDT 後分頻比，必須與 #pragma config WDTPS 相同 (預設 32768)；較小的值提高睡眠時間解析度，但睡眠中較常喚醒 */
+#ifndef POWER_WDT_POSTSCALE
+#define POWER_WDT_POSTSCALE 32768
+#endif
+#if (POWER_WDT_POSTSCALE & (POWER_WDT_POSTSCALE - 1)) || (POWER_WDT_POSTSCALE > 32768)
+#error "POWER_WDT_POSTSCALE" 必須為 1 ~ 32768 的 2 的冪次 (與 WDTPS 相同)
+#endif
+#define POWER_WDT_PERIOD_US (4000UL * POWER_WDT_POSTSCALE)  // WDT 逾時週期 (標稱 4ms × 後分頻比，INTRC 誤差約 ±15%)
+
+typedef struct {
+    uint32_t startMicros;  // 統計開始時間
+    uint32_t idleMicros;   // 累計 IDLE 時間 (不含喚醒後的中斷處理時間)
+    uint16_t idleCount;    // 進入 IDLE 次數
+    uint32_t sleepMicros;  // 累計 SLEEP 時間 (完整 WDT 週期數 × POWER_WDT_PERIOD_US，為下限)
+    uint16_t sleepCount;   // 進入 SLEEP 次數
+} PowerStats;
+
+PowerStats powerStats;  // 電源狀態統計
+
+/**
+ * powerResetStats() - 重設電源狀態統計
+ */
+#define powerResetStats()              \
+    powerStats.startMicros = micros(); \
+    powerStats.idleMicros = 0;         \
+    powerStats.idleCount = 0;          \
+    powerStats.sleepMicros = 0;        \
+    powerStats.sleepCount = 0
+
+/**
+ * powerBegin() - 初始化電源管理
+ * @param priority  CCP1 喚醒中斷優先權 (1=高, 0=低)
+ */
+#define powerBegin(priority)    \
+    IPR1bits.CCP1IP = priority; \
+    powerResetStats()
+
+/**
+ * powerActiveMicros() - 統計期間 CPU 執行的微秒數
+ *
+ * 工作週期 = powerActiveMicros() / powerElapsedMicros()
+ * 平均電流 = (執行 × I_run + idleMicros × I_idle + sleepMicros × I_sleep) / powerElapsedMicros()
+ */
+#define powerActiveMicros() (micros() - powerStats.startMicros - powerStats.idleMicros)
+#define powerElapsedMicros() (micros() - powerStats.startMicros + powerStats.sleepMicros)  // 統計期間總時間 (含睡眠)
+
+/**
+ * _powerIdle() - 在全域中斷關閉時進入 IDLE (GIE = 0)
+ * @param start  進入前的 micros()
+ *
+ * 已致能來源的中斷旗標在 GIE = 0 時仍會喚醒 CPU (旗標已設定時 SLEEP 立即返回)，
+ * 處理函式在呼叫端恢復 GIE 後才執行，因此檢查與進入 IDLE 之間發生的中斷不會遺失
+ */
+void _powerIdle(uint32_t start) {
+    OSCCONbits.IDLEN = 0b1;
+    SLEEP();
+    Nop();
+    powerStats.idleMicros += micros() - start;
+    powerStats.idleCount++;
+}
+
+/**
+ * powerIdle() - 進入 IDLE 直到下一個中斷
+ */
+void powerIdle() {
+    byte gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0b0;
+    _powerIdle(micros());
+    INTCONbits.GIE = gie;
+}
+
+/**
+ * powerIdleUntil() - 進入 IDLE 直到指定時間或任一中斷
+ * @param deadline  喚醒時間 (micros() 的值)
+ * @return          true = 已到達指定時間, false = 被其他中斷提早喚醒
+ *
+ * 距離到期不足一次 Timer1 溢位時，設定 CCPR1 於到期時喚醒
+ * 否則由 Timer1 溢位喚醒，呼叫端再次呼叫即可
+ * 檢查到期、設定 CCPR1 到進入 IDLE 期間關閉全域中斷: 比較符合若在 SLEEP 之前發生，
+ * CCP1IF 保留到 SLEEP 使其立即返回，不會被中斷先清除而一路等到下一次 Timer1 溢位
+ */
+bool powerIdleUntil(uint32_t deadline) {
+    byte gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0b0;
+    uint32_t start = micros();
+    uint32_t wait = deadline - start;
+    if ((int32_t)wait <= ((int32_t)32 << clockMicrosShift)) {
+        INTCONbits.GIE = gie;
+        return true;  // 已到期或太接近，不值得進入 IDLE
+    }
+    if (wait < clockOverflowUs) {
+        CCPR1 = TMR1 + (uint16_t)(wait >> clockMicrosShift);
+        setCCP1Mode(ECCP_MODE_COMPARE_RIO);
+        clearInterrupt_CCP1();
+        PIE1bits.CCP1IE = 0b1;
+    }
+    _powerIdle(start);
+    INTCONbits.GIE = gie;
+    return (int32_t)(deadline - micros()) <= 0;
+}
+
+/**
+ * processPowerWake() - 處理 CCP1 喚醒中斷 (在中斷中呼叫)
+ * @return  true = 已處理 CCP1 喚醒中斷, false = 非喚醒中斷
+ */
+bool processPowerWake() {
+    if (!PIE1bits.CCP1IE || !interruptByCCP1())
+        return false;
+    disableInterrupt_CCP1();
+    clearInterrupt_CCP1();
+    return true;
+}
+
+/**
+ * powerSleep() - 進入 SLEEP 直到外部事件喚醒
+ * @param wakeOnUart  true = UART RX 下降緣可喚醒 (BAUDCON.WUE，喚醒字元會遺失)
+ *
+ * INT0/1/2 與 RB 狀態改變中斷只要 xxIE 已啟用即可喚醒
+ * 睡眠期間啟用 WDT (SWDTEN)，每次逾時喚醒累加一個 POWER_WDT_PERIOD_US 後繼續睡眠，
+ * 直到中斷喚醒為止；最後不足一個週期的部分不計入，每次睡眠最多少計一個 WDT 週期
+ */
+void powerSleep(bool wakeOnUart) {
+    if (wakeOnUart)
+        BAUDCONbits.WUE = 0b1;  // 喚醒後由硬體自動清除
+    OSCCONbits.IDLEN = 0b0;
+    WDTCONbits.SWDTEN = 0b1;
+    for (;;) {
+        SLEEP();  // 設定 TO，並清除 WDT
+        Nop();
+        if (RCONbits.nTO)
+            break;  // 由中斷喚醒 (WDT 逾時會清除 TO)
+        powerStats.sleepMicros += POWER_WDT_PERIOD_US;
+    }
+    WDTCONbits.SWDTEN = 0b0;  // config WDT = ON 時此位元無作用，WDT 持續運作
+    powerStats.sleepCount++;
+}
+
+#endif
+#pragma endregion Power
+
+/* ========== 執行期時脈切換 / Runtime Clock Scaling ========== */
+#pragma region ClockScaling
+/**
+ * 執行期切換內部振盪器頻率 (IRCF 與 PLL)，並自動重新設定周邊 (需在 include 前定義 CLOCK_SCALING)
+ *
+ * 每個頻率的設定預先計算在 const 表中，切換時只需寫入暫存器與移位運算:
+ * - UART: SPBRGH:SPBRG 依 CLOCK_SCALING_BAUD_RATE 重新設定 (BRG16 = 1, BRGH = 1)；
+ *         新頻率的鮑率誤差超過 2% 時 (如 9600 bps 於 250kHz、125kHz) 不切換
+ * - ADC : ADCS 與 ACQT 依新頻率選擇，維持 TAD >= 0.7µs 與取樣時間 >= 2.4µs
+ * - Timer0: 調整預分頻比使計數頻率不變；T0CKI 外部計數 (T0CS = 1) 不受時脈影響，不調整
+ * - Timer1/3: 調整預分頻比；超出 1:1 ~ 1:8 的部分記錄在 timer1CountShift / timer3CountShift，
+ *             週期巨集依此換算預載值，執行中的剩餘計數同時換算；Timer1 自由計數 (系統時間) 時
+ *             改變每個計數的微秒數；外部時脈 (TMRxCS = 1) 不調整
+ * - Timer2/PWM: 重新計算預分頻比、PR2 與 CCPR1/CCPR2 佔空比，使 PWM 週期與脈寬不變；
+ *               計數頻率的變化記錄在 timer2CountShift，之後的 PR2、佔空比與伺服角度設定依此換算
+ * - 切換時未啟用的計時器不調整，之後以 enableTimerX() 啟用時的計數頻率不會換算
+ *
+ * 所有頻率皆為 2 的冪次倍數，換算只需移位
+ * 下列情況不切換並回傳 false: 鮑率誤差過大、Timer0/Timer2 無法以預分頻比吸收、週期換算後超出 16 位元
+ * 或不足 1 個計數、Timer3 自由計數 (Capture) 無法以預分頻比吸收
+ *
+ * 注意: __delay_ms()/__delay_us() 仍以編譯期 _XTAL_FREQ 計算，切換後延遲時間會等比例改變
+ * 啟用 PLL 的設定檔 (32MHz、16MHz) 等待 PLL 鎖定 (TPLL 最長 2ms) 後才恢復中斷，切換本身約需 2 ~ 4ms
+ */
+
+#ifdef CLOCK_SCALING
+
+/* 切換後 UART 使用的鮑率，可在 include 前定義覆蓋 */
+#ifndef CLOCK_SCALING_BAUD_RATE
+#define CLOCK_SCALING_BAUD_RATE 9600
+#endif
+
+/* 時脈設定檔索引 (clockProfiles 表) */
+#define CLOCK_PROFILE_32MHz 0   // 8MHz INTOSC + 4x PLL
+#define CLOCK_PROFILE_16MHz 1   // 4MHz INTOSC + 4x PLL
+#define CLOCK_PROFILE_8MHz 2
+#define CLOCK_PROFILE_4MHz 3
+#define CLOCK_PROFILE_2MHz 4
+#define CLOCK_PROFILE_1MHz 5
+#define CLOCK_PROFILE_500kHz 6
+#define CLOCK_PROFILE_250kHz 7
+#define CLOCK_PROFILE_125kHz 8
+
+/* 對應 _XTAL_FREQ 的啟動設定檔 */
+#if (_XTAL_FREQ == 32000000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_32MHz
+#elif (_XTAL_FREQ == 16000000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_16MHz
+#elif (_XTAL_FREQ == 8000000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_8MHz
+#elif (_XTAL_FREQ == 4000000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_4MHz
+#elif (_XTAL_FREQ == 2000000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_2MHz
+#elif (_XTAL_FREQ == 1000000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_1MHz
+#elif (_XTAL_FREQ == 500000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_500kHz
+#elif (_XTAL_FREQ == 250000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_250kHz
+#elif (_XTAL_FREQ == 125000)
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_125kHz
+#endif
+/* 31 kHz 不是其他頻率的 2 的冪次倍數，不支援執行期切換 */
+
+#ifndef CLOCK_PROFILE_DEFAULT
+#error "CLOCK_SCALING" 需要內部振盪器 125kHz ~ 32MHz 的 "_XTAL_FREQ"
+#endif
+
+typedef struct {
+    byte ircf;       // OSCCON.IRCF
+    byte pllEnable;  // OSCTUNE.PLLEN
+    byte exponent;   // 頻率 = 125kHz × 2^exponent
+    byte adcs;       // ADCON2.ADCS
+    byte acqt;       // ADCON2.ACQT
+    uint16_t brg;    // SPBRGH:SPBRG (BRG16 = 1, BRGH = 1)
+    bool baudOk;     // 實際鮑率與 CLOCK_SCALING_BAUD_RATE 誤差不超過 2%
+} ClockProfile;
+
+#define _CLOCK_PROFILE_BRG(freq) ((uint16_t)(((freq) + 2L * CLOCK_SCALING_BAUD_RATE) / (4L * CLOCK_SCALING_BAUD_RATE) - 1))
+#define _CLOCK_PROFILE_BAUD(freq) ((freq) / (4L * ((uint32_t)_CLOCK_PROFILE_BRG(freq) + 1)))  // 實際鮑率
+#define _CLOCK_PROFILE_BAUD_OK(freq)                                                                                  \
+    (50L * (_CLOCK_PROFILE_BAUD(freq) > CLOCK_SCALING_BAUD_RATE ? _CLOCK_PROFILE_BAUD(freq) - CLOCK_SCALING_BAUD_RATE \
+                                                               : CLOCK_SCALING_BAUD_RATE - _CLOCK_PROFILE_BAUD(freq)) <= CLOCK_SCALING_BAUD_RATE)
+#define _CLOCK_PROFILE_UART(freq) _CLOCK_PROFILE_BRG(freq), _CLOCK_PROFILE_BAUD_OK(freq)
+
+/* PLL 鎖定時間 TPLL (2ms) 以 32MHz 的指令週期計算，16MHz 或鎖定前較慢的時脈只會等待更久 */
+#define _CLOCK_PLL_LOCK_CYCLES (2000UL * (32000000 / 4 / 1000000))
+
+/* 各頻率的預先計算設定 */
+const ClockProfile clockProfiles[] = {
+    {INTERNAL_CLOCK_8MHz, 1, 8, AD_CLOCK_SOURCE_32TOSC, AD_ACQUISITION_TIME_4TAD, _CLOCK_PROFILE_UART(32000000)},
+    {INTERNAL_CLOCK_4MHz, 1, 7, AD_CLOCK_SOURCE_16TOSC, AD_ACQUISITION_TIME_4TAD, _CLOCK_PROFILE_UART(16000000)},
+    {INTERNAL_CLOCK_8MHz, 0, 6, AD_CLOCK_SOURCE_8TOSC, AD_ACQUISITION_TIME_4TAD, _CLOCK_PROFILE_UART(8000000)},
+    {INTERNAL_CLOCK_4MHz, 0, 5, AD_CLOCK_SOURCE_4TOSC, AD_ACQUISITION_TIME_4TAD, _CLOCK_PROFILE_UART(4000000)},
+    {INTERNAL_CLOCK_2MHz, 0, 4, AD_CLOCK_SOURCE_2TOSC, AD_ACQUISITION_TIME_4TAD, _CLOCK_PROFILE_UART(2000000)},
+    {INTERNAL_CLOCK_1MHz, 0, 3, AD_CLOCK_SOURCE_2TOSC, AD_ACQUISITION_TIME_2TAD, _CLOCK_PROFILE_UART(1000000)},
+    {INTERNAL_CLOCK_500kHz, 0, 2, AD_CLOCK_SOURCE_2TOSC, AD_ACQUISITION_TIME_2TAD, _CLOCK_PROFILE_UART(500000)},
+    {INTERNAL_CLOCK_250kHz, 0, 1, AD_CLOCK_SOURCE_2TOSC, AD_ACQUISITION_TIME_2TAD, _CLOCK_PROFILE_UART(250000)},
+    {INTERNAL_CLOCK_125kHz, 0, 0, AD_CLOCK_SOURCE_2TOSC, AD_ACQUISITION_TIME_2TAD, _CLOCK_PROFILE_UART(125000)},
+};
+
+byte clockProfile = CLOCK_PROFILE_DEFAULT;  // 目前使用中的設定檔
+
+/* 以移位換算數值: shift > 0 左移，shift < 0 右移 */
+#define _clockShift(value, shift) ((shift) >= 0 ? (value) << (shift) : (value) >> -(shift))
+
+/* 預分頻比 (2 的冪次) 超出 0 ~ max 的部分 */
+#define _clockPrescaleRest(prescale, max) ((prescale) < 0 ? (prescale) : (prescale) > (max) ? (prescale) - (max) : 0)
+
+/**
+ * _clockPeriodFits() - 週期計數以 2^shift 換算後是否仍在 1 ~ 65536 個計數
+ */
+bool _clockPeriodFits(uint16_t counts, signed char shift) {
+    uint32_t scaled = _clockShift((uint32_t)counts, shift);
+    return scaled && scaled <= 65536UL;
+}
+
+/**
+ * _clockRescaleTimer() - 將 16 位元計時器到溢位前的剩餘計數以 2^shift 換算
+ * @param value  目前計數值
+ * @return       換算後的計數值 (剩餘計數限制在 1 ~ 65536)
+ */
+uint16_t _clockRescaleTimer(uint16_t value, signed char shift) {
+    uint32_t remaining = _clockShift(65536UL - value, shift);
+    if (!remaining)
+        remaining = 1;
+    if (remaining > 65536UL)
+        remaining = 65536UL;
+    return (uint16_t)(65536UL - remaining);
+}
+
+/**
+ * setClockProfile() - 切換系統時脈並重新設定周邊
+ * @param profile  設定檔 (CLOCK_PROFILE_x)
+ * @return         true = 已切換, false = 鮑率誤差過大或執行中的計時器無法維持相同週期，未切換
+ *
+ * 切換期間暫停全域中斷，所有周邊暫存器一次更新完成
+ */
+bool setClockProfile(byte profile) {
+    const ClockProfile* next = &clockProfiles[profile];
+    signed char k = (signed char)(next->exponent - clockProfiles[clockProfile].exponent);
+
+    if (RCSTAbits.SPEN && !next->baudOk)
+        return false;
+
+    // 計算新的計時器預分頻比 (以 2 的冪次表示)，只處理以內部指令週期計數的計時器
+    bool t0Scale = T0CONbits.TMR0ON && !T0CONbits.T0CS;
+    bool t1Scale = T1CONbits.TMR1ON && !T1CONbits.TMR1CS;
+    bool t3Scale = T3CONbits.TMR3ON && !T3CONbits.TMR3CS;
+    signed char t0 = (signed char)(T0CONbits.PSA ? 0 : T0CONbits.T0PS + 1) + k;  // 1:1 ~ 1:256
+    signed char t1 = (signed char)T1CONbits.T1CKPS + k;                           // 1:1 ~ 1:8
+    signed char t3 = (signed char)T3CONbits.T3CKPS + k;                           // 1:1 ~ 1:8
+    if (t0Scale && (t0 < 0 || t0 > 8))
+        return false;
+
+    // Timer1/3: 預分頻比吸收不了的部分改由週期換算 (週期模式) 或系統時間的微秒位移 (Timer1 自由計數)
+    signed char t1Rest = _clockPrescaleRest(t1, 3);
+    signed char t3Rest = _clockPrescaleRest(t3, 3);
+    t1 -= t1Rest;
+    t3 -= t3Rest;
+    if (t1Scale && t1Rest) {
+        if (timer1PeriodCounts) {
+            if (!_clockPeriodFits(timer1PeriodCounts, (signed char)(timer1CountShift + t1Rest)))
+                return false;
+        } else if ((signed char)clockMicrosShift - t1Rest < 0) {
+            return false;  // 每個計數不足 1µs
+        }
+    }
+    if (t3Scale && t3Rest && (!timer3PeriodCounts || !_clockPeriodFits(timer3PeriodCounts, (signed char)(timer3CountShift + t3Rest))))
+        return false;
+
+    // Timer2: 週期計數 (PR2 + 1) × 預分頻比，換算後選擇能放入 8 位元 PR2 的最小預分頻比 (1, 4, 16)
+    byte t2Old = (byte)(T2CONbits.T2CKPS >= 0b10 ? 4 : T2CONbits.T2CKPS * 2);  // 1:1, 1:4, 1:16 → 0, 2, 4
+    uint32_t t2Period = _clockShift((uint32_t)PR2 + 1, (signed char)(t2Old + k));
+    byte t2New = 0;
+    while (t2New < 4 && (t2Period >> t2New) > 256)
+        t2New += 2;
+    if (T2CONbits.TMR2ON && ((t2Period >> t2New) > 256 || (t2Period >> t2New) == 0))
+        return false;
+    signed char t2Shift = (signed char)(k + t2Old - t2New);
+
+    if (TXSTAbits.TXEN)
+        while (!TXSTAbits.TRMT);  // 等待傳送中的位元組完成
+
+    byte gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0b0;
+
+    // 系統時間: 以舊的計數頻率累加目前計數後重新計數
+    if (t1Scale && t1Rest && !timer1PeriodCounts)
+        _clockRescale((byte)(clockMicrosShift - t1Rest));
+
+    // 振盪器: 關閉 PLL 後再改 IRCF，需要 PLL 時最後啟用
+    OSCTUNEbits.PLLEN = 0b0;
+    OSCCONbits.IRCF = next->ircf;
+    Nop();
+    OSCTUNEbits.PLLEN = next->pllEnable;
+    if (next->pllEnable)
+        _delay(_CLOCK_PLL_LOCK_CYCLES);  // 等待 PLL 鎖定後才恢復中斷與 UART
+
+    // 計時器預分頻比與週期換算
+    if (t0Scale) {
+        T0CONbits.PSA = t0 ? TIMER0_PRESCALE_ENABLE : TIMER0_PRESCALE_DISABLE;
+        T0CONbits.T0PS = t0 ? t0 - 1 : 0;
+    }
+    if (t1Scale) {
+        T1CONbits.T1CKPS = t1;
+        timer1CountShift += t1Rest;
+        if (t1Rest && timer1PeriodCounts)
+            TMR1 = _clockRescaleTimer(TMR1, t1Rest);
+    }
+    if (t3Scale) {
+        T3CONbits.T3CKPS = t3;
+        timer3CountShift += t3Rest;
+        if (t3Rest)
+            TMR3 = _clockRescaleTimer(TMR3, t3Rest);
+    }
+
+    // Timer2 週期與 CCP PWM 佔空比 (10 位元 CCPRxL:DCxB)
+    if (T2CONbits.TMR2ON) {
+        T2CONbits.T2CKPS = t2New >> 1;
+        PR2 = (byte)((t2Period >> t2New) - 1);
+        timer2CountShift += t2Shift;
+        uint16_t duty1 = _clockShift((uint16_t)(CCPR1L << 2 | CCP1CONbits.DC1B), t2Shift);
+        uint16_t duty2 = _clockShift((uint16_t)(CCPR2L << 2 | CCP2CONbits.DC2B), t2Shift);
+        if (CCP1CONbits.CCP1M >= ECCP_MODE_PWM_HH) {
+            CCP1CONbits.DC1B = duty1 & 0b11;
+            CCPR1L = (byte)(duty1 >> 2);
+        }
+        if (CCP2CONbits.CCP2M >= ECCP_MODE_PWM_HH) {
+            CCP2CONbits.DC2B = duty2 & 0b11;
+            CCPR2L = (byte)(duty2 >> 2);
+        }
+    }
+
+    // UART 鮑率
+    if (RCSTAbits.SPEN) {
+        BAUDCONbits.BRG16 = 1;
+        TXSTAbits.BRGH = 1;
+        SPBRGH = (byte)(next->brg >> 8);
+        SPBRG = (byte)next->brg;
+    }
+
+    // ADC 時脈與取樣時間
+    ADCON2bits.ADCS = next->adcs;
+    ADCON2bits.ACQT = next->acqt;
+
+    clockProfile = profile;
+    INTCONbits.GIE = gie;
+    return true;
+}
+
+#define getClockFrequency() (125000UL << clockProfiles[clockProfile].exponent)  // 目前系統頻率 (Hz)
+
+#endif
+#pragma endregion ClockScaling
+
+/* ========== 輸入捕獲 / Input Capture ========== */
+#pragma region Capture
+/**
+ * 以 CCP1 (RC2) / CCP2 (RC1) 捕獲模式量測頻率、週期、脈寬與轉速
+ *
+ * - 兩個通道皆以 Timer3 自由計數為時基 (CCP_TIMER_SOURCE_T3_T3)，軟體溢位計數延伸為 32 位元時間戳
+ * - 捕獲中斷將時間戳寫入通道的環形緩衝區，並更新最新的週期與高電位寬度
+ * - CAPTURE_MODE_PERIOD: 捕獲上升緣，輸入過快時自動切換為每 4 / 16 個上升緣捕獲一次，限制中斷負載
+ * - CAPTURE_MODE_PULSE: 交替捕獲上升緣與下降緣，量測高電位寬度與佔空比 (不使用預分頻)
+ * - 週期、頻率、佔空比與轉速皆以整數定點運算
+ *
+ * 注意: Timer3 與 CCP1/CCP2 由捕獲使用，不可與音調、CCP2 DDS、伺服 PWM、powerIdleUntil() 同時使用
+ */
+
+/* Timer3 預分頻比數值 (1, 2, 4, 8) 與環形緩衝區大小 (2 的冪次)，可在 include 前定義覆蓋 */
+#ifndef CAPTURE_TIMER3_PRESCALE
+#define CAPTURE_TIMER3_PRESCALE 1
+#endif
+#ifndef CAPTURE_BUFFER_SIZE
+#define CAPTURE_BUFFER_SIZE 8
+#endif
+/* 兩次捕獲中斷的最小間隔 (Timer3 計數)，低於此值時提高捕獲預分頻 */
+#ifndef CAPTURE_MIN_INTERVAL
+#define CAPTURE_MIN_INTERVAL 256
+#endif
+
+#if (CAPTURE_BUFFER_SIZE & (CAPTURE_BUFFER_SIZE - 1)) || (CAPTURE_BUFFER_SIZE > 128)
+#error "CAPTURE_BUFFER_SIZE" 必須為 2 的冪次且不可超過 128
+#endif
+
+#define CAPTURE_TICKS_PER_SECOND (_XTAL_FREQ / 4 / CAPTURE_TIMER3_PRESCALE)  // Timer3 每秒計數
+
+#define CAPTURE_CHANNEL_CCP1 0  // CCP1 (RC2)
+#define CAPTURE_CHANNEL_CCP2 1  // CCP2 (RC1)
+
+#define CAPTURE_MODE_PERIOD 0  // 上升緣，自動預分頻
+#define CAPTURE_MODE_PULSE 1   // 上升緣與下降緣交替
+
+/* CaptureEvent.flags */
+#define CAPTURE_FLAG_DIVISOR 0x1F  // 與前一筆之間的上升緣數 (1, 4, 16)
+#define CAPTURE_FLAG_FALLING 0x40  // 下降緣
+#define CAPTURE_FLAG_RESTART 0x80  // 與前一筆不連續 (剛啟動或切換預分頻)
+
+typedef struct {
+    uint32_t time;  // Timer3 時間戳 (計數)
+    byte flags;     // CAPTURE_FLAG_x
+} CaptureEvent;
+
+typedef struct {
+    CaptureEvent events[CAPTURE_BUFFER_SIZE];
+    volatile byte head;          // 寫入位置 (中斷)
+    volatile byte tail;          // 讀取位置 (主程式)
+    byte mode;                   // CAPTURE_MODE_x
+    byte shift;                  // 目前捕獲預分頻 (0, 2, 4 = 1, 4, 16 個上升緣)
+    bool falling;                // 脈寬模式: 目前等待下降緣
+    bool restart;                // 下一筆與前一筆不連續
+    uint32_t lastTime;           // 上一次捕獲的上升緣時間
+    volatile uint32_t period;    // 最新輸入週期 (計數，0 = 尚未量測)
+    volatile uint32_t highTime;  // 最新高電位寬度 (計數，脈寬模式)
+    volatile byte dropped;       // 緩衝區已滿而丟棄的事件數 (飽和於 255)
+} CaptureChannel;
+
+CaptureChannel captureChannels[2];  // CAPTURE_CHANNEL_CCP1 / CAPTURE_CHANNEL_CCP2
+volatile uint16_t captureOverflows;  // Timer3 溢位次數 (時間戳的高 16 位元)
+
+/**
+ * captureBegin() - 啟動捕獲時基 (Timer3 自由計數)
+ * @param priority  Timer3 溢位中斷優先權 (1=高, 0=低)，需與捕獲中斷相同
+ */
+#define captureBegin(priority)                                                   \
+    captureOverflows = 0;                                                        \
+    _timer3FreeRunning();                                                        \
+    setCCPTimerSource(CCP_TIMER_SOURCE_T3_T3);                                   \
+    TMR3 = 0;                                                                    \
+    T3CONbits.RD16 = 1;                                                          \
+    enableTimer3(MACRO_CODE_XCONCAT(TIMER3_PRESCALE_, CAPTURE_TIMER3_PRESCALE)); \
+    enableInterrupt_Timer3Overflow(priority)
+
+/**
+ * _captureSetMode() - 切換通道的捕獲模式
+ *
+ * 先關閉 CCP 以清除捕獲預分頻計數器，再寫入新模式並清除切換時可能產生的假中斷
+ */
+void _captureSetMode(byte channel, byte eccpMode) {
+    if (channel == CAPTURE_CHANNEL_CCP1) {
+        setCCP1Mode(ECCP_MODE_OFF);
+        setCCP1Mode(eccpMode);
+        clearInterrupt_CCP1();
+    } else {
+        setCCP2Mode(ECCP_MODE_OFF);
+        setCCP2Mode(eccpMode);
+        clearInterrupt_CCP2();
+    }
+}
+
+/**
+ * captureStart() - 開始在通道上捕獲
+ * @param channel   通道 (CAPTURE_CHANNEL_x)
+ * @param mode      量測模式 (CAPTURE_MODE_x)
+ * @param priority  捕獲中斷優先權 (1=高, 0=低)
+ */
+void captureStart(byte channel, byte mode, byte priority) {
+    CaptureChannel *ch = &captureChannels[channel];
+    ch->head = 0;
+    ch->tail = 0;
+    ch->mode = mode;
+    ch->shift = 0;
+    ch->falling = false;
+    ch->restart = true;
+    ch->period = 0;
+    ch->highTime = 0;
+    ch->dropped = 0;
+    _captureSetMode(channel, ECCP_MODE_CAPTURE_ERE);
+    if (channel == CAPTURE_CHANNEL_CCP1) {
+        pinMode(PIN_RC2, PIN_INPUT);
+        enableInterrupt_CCP1(priority);
+    } else {
+        pinMode(PIN_RC1, PIN_INPUT);
+        enableInterrupt_CCP2(priority);
+    }
+}
+
+/**
+ * captureStop() - 停止通道捕獲
+ * @param channel  通道 (CAPTURE_CHANNEL_x)
+ */
+void captureStop(byte channel) {
+    if (channel == CAPTURE_CHANNEL_CCP1) {
+        disableInterrupt_CCP1();
+        setCCP1Mode(ECCP_MODE_OFF);
+    } else {
+        disableInterrupt_CCP2();
+        setCCP2Mode(ECCP_MODE_OFF);
+    }
+}
+
+/**
+ * _captureEvent() - 記錄一次捕獲 (由 processCapture 呼叫)
+ * @param channel  通道 (CAPTURE_CHANNEL_x)
+ * @param value    CCPRx 捕獲值
+ *
+ * 溢位已發生但尚未處理時，捕獲值位於下半段表示捕獲發生在溢位之後
+ */
+void _captureEvent(byte channel, uint16_t value) {
+    CaptureChannel *ch = &captureChannels[channel];
+    uint16_t high = captureOverflows;
+    if (interruptByTimer3Overflow() && !(value & 0x8000))
+        high++;
+    uint32_t time = ((uint32_t)high << 16) | value;
+    uint32_t interval = time - ch->lastTime;
+    byte flags = (byte)(1 << ch->shift);
+    bool restart = ch->restart;
+    if (restart)
+        flags |= CAPTURE_FLAG_RESTART;
+    ch->restart = false;
+
+    if (ch->mode == CAPTURE_MODE_PULSE) {
+        if (ch->falling) {
+            // 高電位寬度: 上一個上升緣到此下降緣
+            flags |= CAPTURE_FLAG_FALLING;
+            ch->highTime = interval;
+            ch->falling = false;
+            _captureSetMode(channel, ECCP_MODE_CAPTURE_ERE);
+        } else {
+            if (!restart)
+                ch->period = interval;
+            ch->lastTime = time;
+            ch->falling = true;
+            _captureSetMode(channel, ECCP_MODE_CAPTURE_EFE);
+        }
+    } else {
+        ch->lastTime = time;
+        if (!restart) {
+            ch->period = interval >> ch->shift;
+            // 依中斷間隔調整捕獲預分頻 (ERE -> R04 -> R16)，降低時保留 2 倍遲滯
+            byte shift = ch->shift;
+            if (interval < CAPTURE_MIN_INTERVAL && shift < 4)
+                shift += 2;
+            else if (shift && interval > CAPTURE_MIN_INTERVAL * 8)
+                shift -= 2;
+            if (shift != ch->shift) {
+                ch->shift = shift;
+                ch->restart = true;  // 預分頻計數器已清除，下一筆間隔不完整
+                _captureSetMode(channel, ECCP_MODE_CAPTURE_ERE + (shift >> 1));
+            }
+        }
+    }
+
+    if ((byte)(ch->head - ch->tail) < CAPTURE_BUFFER_SIZE) {
+        CaptureEvent *event = &ch->events[ch->head & (CAPTURE_BUFFER_SIZE - 1)];
+        event->time = time;
+        event->flags = flags;
+        ch->head++;
+    } else if (ch->dropped != 255) {
+        ch->dropped++;
+    }
+}
+
+/**
+ * processCapture() - 處理捕獲與 Timer3 溢位中斷 (在中斷中呼叫)
+ * @return  true = 已處理捕獲相關中斷, false = 非捕獲中斷
+ *
+ * 先處理捕獲再累加溢位計數，捕獲時間戳才能以尚未清除的 TMR3IF 補正
+ */
+bool processCapture() {
+    bool handled = false;
+    if (PIE1bits.CCP1IE && interruptByCCP1()) {
+        clearInterrupt_CCP1();
+        _captureEvent(CAPTURE_CHANNEL_CCP1, CCPR1);
+        handled = true;
+    }
+    if (PIE2bits.CCP2IE && interruptByCCP2()) {
+        clearInterrupt_CCP2();
+        _captureEvent(CAPTURE_CHANNEL_CCP2, CCPR2);
+        handled = true;
+    }
+    if (interruptByTimer3Overflow()) {
+        clearInterrupt_Timer3Overflow();
+        captureOverflows++;
+        handled = true;
+    }
+    return handled;
+}
+
+/**
+ * captureRead() - 從通道緩衝區取出一筆捕獲事件
+ * @param channel  通道 (CAPTURE_CHANNEL_x)
+ * @param event    輸出事件
+ * @return         true = 已取出, false = 緩衝區為空
+ */
+bool captureRead(byte channel, CaptureEvent *event) {
+    CaptureChannel *ch = &captureChannels[channel];
+    if (ch->head == ch->tail)
+        return false;
+    *event = ch->events[ch->tail & (CAPTURE_BUFFER_SIZE - 1)];
+    ch->tail++;
+    return true;
+}
+
+#define captureAvailable(channel) ((byte)(captureChannels[channel].head - captureChannels[channel].tail))  // 緩衝區中的事件數
+
+/**
+ * _captureLoad() - 讀取由中斷更新的 32 位元量測值
+ *
+ * 讀取期間被中斷更新則重讀，不需關閉中斷
+ */
+uint32_t _captureLoad(volatile uint32_t *value) {
+    uint32_t result;
+    do {
+        result = *value;
+    } while (result != *value);
+    return result;
+}
+
+/**
+ * captureNow() - 取得目前的 Timer3 時間戳，用於判斷輸入是否已停止
+ * @return  與 CaptureEvent.time 相同時基的 32 位元計數
+ */
+uint32_t captureNow() {
+    uint16_t high;
+    uint16_t low;
+    bool pending;
+    do {
+        high = captureOverflows;
+        low = TMR3;  // RD16: 讀取 TMR3L 同時鎖存 TMR3H
+        pending = interruptByTimer3Overflow();
+    } while (high != captureOverflows);
+    if (pending && !(low & 0x8000))
+        high++;
+    return ((uint32_t)high << 16) | low;
+}
+
+#define capturePeriodTicks(channel) _captureLoad(&captureChannels[channel].period)      // 最新輸入週期 (計數)
+#define captureHighTicks(channel) _captureLoad(&captureChannels[channel].highTime)      // 最新高電位寬度 (計數)
+
+/**
+ * captureTicksToMicros() - 將 Timer3 計數換算為微秒
+ * @param ticks  計數
+ * @return       微秒數
+ *
+ * 以 kHz 為單位拆成商與餘數計算，避免 32 位元溢位且適用非整數 MHz 的頻率
+ */
+uint32_t captureTicksToMicros(uint32_t ticks) {
+    uint32_t quotient = ticks / (_XTAL_FREQ / 1000);
+    uint32_t remainder = ticks % (_XTAL_FREQ / 1000);
+    return quotient * (4000UL * CAPTURE_TIMER3_PRESCALE) +
+           remainder * (4000UL * CAPTURE_TIMER3_PRESCALE) / (_XTAL_FREQ / 1000);
+}
+
+#define capturePeriodMicros(channel) captureTicksToMicros(capturePeriodTicks(channel))  // 最新輸入週期 (微秒 µs)
+#define captureHighMicros(channel) captureTicksToMicros(captureHighTicks(channel))      // 最新高電位寬度 (微秒 µs)
+
+/**
+ * captureFrequency() - 取得輸入頻率
+ * @param channel  通道 (CAPTURE_CHANNEL_x)
+ * @return         頻率 (Hz × 256，24.8 定點數)，尚未量測時為 0
+ */
+uint32_t captureFrequency(byte channel) {
+    uint32_t period = capturePeriodTicks(channel);
+    if (!period)
+        return 0;
+    return ((uint32_t)CAPTURE_TICKS_PER_SECOND << 8) / period;
+}
+
+/**
+ * captureDuty() - 取得佔空比 (脈寬模式)
+ * @param channel  通道 (CAPTURE_CHANNEL_x)
+ * @return         佔空比 (0.1% 為單位，0-1000)
+ *
+ * 週期過長時兩者同時右移，避免乘以 1000 時溢位
+ */
+uint16_t captureDuty(byte channel) {
+    uint32_t period = capturePeriodTicks(channel);
+    uint32_t highTime = captureHighTicks(channel);
+    while (period > 0x3FFFFF) {
+        period >>= 1;
+        highTime >>= 1;
+    }
+    if (!period)
+        return 0;
+    if (highTime > period)
+        return 1000;
+    return (uint16_t)(highTime * 1000 / period);
+}
+
+/**
+ * captureRpm() - 取得轉速
+ * @param channel            通道 (CAPTURE_CHANNEL_x)
+ * @param pulsesPerRevolution 每轉脈衝數
+ * @return                   每分鐘轉數 (RPM)
+ */
+uint32_t captureRpm(byte channel, byte pulsesPerRevolution) {
+    uint32_t period = capturePeriodTicks(channel);
+    if (!period)
+        return 0;
+    return (CAPTURE_TICKS_PER_SECOND * 60UL / pulsesPerRevolution) / period;
+}
+#pragma endregion Capture
+
+/* ========== 外部事件計數 / External Event Counter ========== */
+#pragma region Counter
+/**
+ * 以 Timer0 的 T0CKI 腳位 (RA4) 硬體計數外部脈衝 (流量計、編碼器等)
+ *
+ * - 每個脈衝由硬體計數，不產生中斷，只有 16 位元溢位時中斷一次以延伸為 32 位元
+ * - 可選擇預分頻 (COUNTER_PRESCALE)，計數解析度變為預分頻比，但可量測更高頻率
+ * - 閘控頻率量測: Timer1 每 COUNTER_GATE_PERIOD 中斷一次，累積指定次數後計算每秒脈衝數
+ * - 不使用預分頻時，T0CKI 高/低電位需各至少 0.5 TCY + 20ns (參考 datasheet 參數 40/41)
+ *
+ * 注意: Timer0 由計數器使用，不可與排程器同時使用；閘控量測使用 Timer1，不可與系統時間同時使用
+ */
+
+/* 預分頻比數值 (1, 2, 4, ..., 256) 與閘控 Timer1 週期 (微秒 µs)，可在 include 前定義覆蓋 */
+#ifndef COUNTER_PRESCALE
+#define COUNTER_PRESCALE 1
+#endif
+#ifndef COUNTER_GATE_PERIOD
+#define COUNTER_GATE_PERIOD 50000
+#endif
+#ifndef COUNTER_GATE_PRESCALE
+#define COUNTER_GATE_PRESCALE 8
+#endif
+
+/* 依預分頻比選擇 T0PS 與計數換算為脈衝數的位移 */
+#if (COUNTER_PRESCALE == 1)
+#define COUNTER_SHIFT 0
+#elif (COUNTER_PRESCALE == 2)
+#define COUNTER_SHIFT 1
+#elif (COUNTER_PRESCALE == 4)
+#define COUNTER_SHIFT 2
+#elif (COUNTER_PRESCALE == 8)
+#define COUNTER_SHIFT 3
+#elif (COUNTER_PRESCALE == 16)
+#define COUNTER_SHIFT 4
+#elif (COUNTER_PRESCALE == 32)
+#define COUNTER_SHIFT 5
+#elif (COUNTER_PRESCALE == 64)
+#define COUNTER_SHIFT 6
+#elif (COUNTER_PRESCALE == 128)
+#define COUNTER_SHIFT 7
+#elif (COUNTER_PRESCALE == 256)
+#define COUNTER_SHIFT 8
+#else
+#error 不合法的 "COUNTER_PRESCALE"，只能為 1, 2, 4, ..., 256
+#endif
+
+#if (1000000 % COUNTER_GATE_PERIOD)
+#error "COUNTER_GATE_PERIOD" 必須能整除 1000000
+#endif
+
+/* T0CKI 計數邊緣 (T0SE 位元) */
+#define COUNTER_EDGE_RISING 0b0   // 上升緣計數
+#define COUNTER_EDGE_FALLING 0b1  // 下降緣計數
+
+volatile uint16_t counterOverflows;  // Timer0 溢位次數 (計數的高 16 位元)
+
+/**
+ * counterBegin() - 啟動 T0CKI 外部事件計數
+ * @param edge      計數邊緣 (COUNTER_EDGE_x)
+ * @param priority  Timer0 溢位中斷優先權 (1=高, 0=低)
+ */
+#define counterBegin(edge, priority)                                               \
+    pinMode(PIN_RA4, PIN_INPUT);                                                   \
+    counterOverflows = 0;                                                          \
+    T0CONbits.T0SE = edge;                                                         \
+    enableTimer0(COUNTER_SHIFT ? COUNTER_SHIFT - 1 : 0,                            \
+                 COUNTER_SHIFT ? TIMER0_PRESCALE_ENABLE : TIMER0_PRESCALE_DISABLE, \
+                 TIMER0_CLOCK_SOURCE_T0CKI_PIN, TIMER0_MODE_16BIT);                \
+    TMR0 = 0;                                                                      \
+    enableInterrupt_Timer0Overflow(priority)
+
+/**
+ * processCounter() - 處理 Timer0 溢位 (在中斷中呼叫)
+ * @return  true = 已處理 Timer0 中斷, false = 非 Timer0 中斷
+ */
+bool processCounter() {
+    if (!interruptByTimer0Overflow())
+        return false;
+    clearInterrupt_Timer0Overflow();
+    counterOverflows++;
+    return true;
+}
+
+/**
+ * counterRead() - 取得累計脈衝數
+ * @return  32 位元脈衝數 (解析度為 COUNTER_PRESCALE)
+ *
+ * 與 micros() 相同: 讀取期間溢位計數改變則重讀，溢位尚未處理時以 TMR0IF 補正
+ * 讀取 TMR0L 時同時鎖存 TMR0H
+ */
+uint32_t counterRead() {
+    uint16_t high;
+    uint16_t low;
+    bool pending;
+    do {
+        high = counterOverflows;
+        low = TMR0;
+        pending = interruptByTimer0Overflow();
+    } while (high != counterOverflows);
+    if (pending && !(low & 0x8000))
+        high++;
+    return (((uint32_t)high << 16) | low) << COUNTER_SHIFT;
+}
+
+/**
+ * counterReset() - 將計數歸零 (預分頻器的計數同時清除)
+ */
+#define counterReset()               \
+    INTCONbits.TMR0IE = 0b0;         \
+    TMR0 = 0;                        \
+    counterOverflows = 0;            \
+    clearInterrupt_Timer0Overflow(); \
+    INTCONbits.TMR0IE = 0b1
+
+byte counterGateWindows;                // 每次量測的 Timer1 週期數
+byte counterGateCountdown;              // 距離量測完成的 Timer1 週期數
+uint32_t counterGateStart;              // 量測開始時的計數
+volatile uint32_t counterGatePulses;    // 最近一次量測窗內的脈衝數
+volatile bool counterRateReady;         // 有新的量測結果
+
+/**
+ * counterGateBegin() - 啟動閘控頻率量測
+ * @param windows   量測窗長度 (COUNTER_GATE_PERIOD 的倍數，1-255)
+ * @param priority  Timer1 溢位中斷優先權 (1=高, 0=低)
+ *
+ * 例: COUNTER_GATE_PERIOD = 50000 時 windows = 20 為 1 秒量測窗
+ */
+#define counterGateBegin(windows, priority)                                    \
+    counterGateWindows = windows;                                              \
+    counterGateCountdown = windows;                                            \
+    counterGatePulses = 0;                                                     \
+    counterRateReady = false;                                                  \
+    counterGateStart = counterRead();                                          \
+    enableTimer1(MACRO_CODE_XCONCAT(TIMER1_PRESCALE_, COUNTER_GATE_PRESCALE)); \
+    setTimer1InterruptPeriod(COUNTER_GATE_PERIOD, COUNTER_GATE_PRESCALE);      \
+    enableInterrupt_Timer1Overflow(priority)
+
+/**
+ * processCounterGate() - 處理閘控 Timer1 溢位 (在中斷中呼叫)
+ * @return  true = 已處理 Timer1 中斷, false = 非 Timer1 中斷
+ */
+bool processCounterGate() {
+    if (!interruptByTimer1Overflow())
+        return false;
+    clearInterrupt_Timer1Overflow();
+    addTimer1InterruptPeriod(COUNTER_GATE_PERIOD, COUNTER_GATE_PRESCALE);
+    if (--counterGateCountdown == 0) {
+        uint32_t now = counterRead();
+        counterGatePulses = now - counterGateStart;
+        counterGateStart = now;
+        counterGateCountdown = counterGateWindows;
+        counterRateReady = true;
+    }
+    return true;
+}
+
+/**
+ * counterRate() - 取得最近一次量測窗的每秒脈衝數
+ * @return  頻率 (Hz)
+ *
+ * 讀取後清除 counterRateReady
+ */
+uint32_t counterRate() {
+    uint32_t pulses;
+    do {
+        counterRateReady = false;
+        pulses = counterGatePulses;
+    } while (counterRateReady);
+    return pulses * (1000000 / COUNTER_GATE_PERIOD) / counterGateWindows;
+}
+#pragma endregion Counter
+
+/* ========== 按鍵去彈跳 / Button Debouncing ========== */
+#pragma region Debounce
+/**
+ * 定時取樣整個連接埠，以垂直計數器同時對 8 個腳位去彈跳
+ *
+ * - debounceTick() 由週期性中斷呼叫 (建議 5-10ms)，每個連接埠只需數個位元運算
+ * - 每個腳位有一個 2 位元計數器，分散在 count0/count1 的同一位元 (垂直計數器)
+ *   取樣值與穩定狀態不同時計數，連續 4 次不同才改變狀態，中途相同則重設
+ * - 狀態改變時產生 按下 / 放開 / 長按 / 雙擊 事件，寫入事件佇列由主程式讀取
+ * - 不需在中斷中延遲，其他中斷不會被阻塞
+ *
+ * 事件編碼: 高 2 位元為事件種類 (DEBOUNCE_EVENT_x)，低 6 位元為按鍵編號 (連接埠索引 × 8 + 腳位)
+ */
+
+/* 連接埠數量、事件佇列大小 (2 的冪次) 與時間設定 (節拍數)，可在 include 前定義覆蓋 */
+#ifndef DEBOUNCE_MAX_PORTS
+#define DEBOUNCE_MAX_PORTS 1
+#endif
+#ifndef DEBOUNCE_QUEUE_SIZE
+#define DEBOUNCE_QUEUE_SIZE 8
+#endif
+#ifndef DEBOUNCE_LONG_PRESS_TICKS
+#define DEBOUNCE_LONG_PRESS_TICKS 100  // 按住多久視為長按 (10ms 節拍時為 1 秒)
+#endif
+#ifndef DEBOUNCE_DOUBLE_CLICK_TICKS
+#define DEBOUNCE_DOUBLE_CLICK_TICKS 30  // 放開後多久內再按下視為雙擊 (10ms 節拍時為 300ms)
+#endif
+
+#if (DEBOUNCE_MAX_PORTS > 5)
+#error "DEBOUNCE_MAX_PORTS" 不可超過 5 (PORTA ~ PORTE)
+#endif
+#if (DEBOUNCE_QUEUE_SIZE & (DEBOUNCE_QUEUE_SIZE - 1)) || (DEBOUNCE_QUEUE_SIZE > 128)
+#error "DEBOUNCE_QUEUE_SIZE" 必須為 2 的冪次且不可超過 128
+#endif
+/* 節拍計數 debounceHold 為位元組並飽和於 255: 長按等於 255 時會每個節拍重複觸發 */
+#if (DEBOUNCE_LONG_PRESS_TICKS > 254) || (DEBOUNCE_DOUBLE_CLICK_TICKS > 255)
+#error "DEBOUNCE_LONG_PRESS_TICKS" 不可超過 254，"DEBOUNCE_DOUBLE_CLICK_TICKS" 不可超過 255 (加長節拍週期)
+#endif
+
+/* 事件種類 */
+#define DEBOUNCE_EVENT_PRESS 0x00         // 按下
+#define DEBOUNCE_EVENT_RELEASE 0x40       // 放開
+#define DEBOUNCE_EVENT_LONG_PRESS 0x80    // 按住超過 DEBOUNCE_LONG_PRESS_TICKS
+#define DEBOUNCE_EVENT_DOUBLE_CLICK 0xC0  // 放開後 DEBOUNCE_DOUBLE_CLICK_TICKS 內再次按下 (同時產生 PRESS)
+#define DEBOUNCE_EVENT_NONE 0xFF          // 佇列為空
+
+#define debounceEventType(event) ((event) & 0xC0)  // 取得事件種類
+#define debounceEventKey(event) ((event) & 0x3F)   // 取得按鍵編號
+#define DEBOUNCE_KEY(port, pin) ((port) * 8 + (pin))  // 連接埠索引與腳位 (0-7) 轉換為按鍵編號
+
+typedef struct {
+    volatile unsigned char *port;  // 取樣的 PORTx 暫存器，NULL = 未使用
+    byte mask;                     // 參與去彈跳的腳位
+    byte invert;                   // 低電位有效的腳位 (接地按鈕 + 上拉)
+    byte state;                    // 去彈跳後狀態 (1 = 按下)
+    byte count0;                   // 垂直計數器位元 0
+    byte count1;                   // 垂直計數器位元 1
+    byte gap;                      // 仍在雙擊判斷時間內的腳位
+} DebouncePort;
+
+DebouncePort debouncePorts[DEBOUNCE_MAX_PORTS];
+byte debounceHold[DEBOUNCE_MAX_PORTS * 8];  // 各按鍵按住或放開後經過的節拍數
+byte debounceQueue[DEBOUNCE_QUEUE_SIZE];
+volatile byte debounceQueueHead;  // 寫入位置 (中斷)
+volatile byte debounceQueueTail;  // 讀取位置 (主程式)
+volatile byte debounceDropped;    // 佇列已滿而丟棄的事件數 (飽和於 255)
+
+/**
+ * debounceAddPort() - 設定要去彈跳的連接埠
+ * @param index     連接埠索引 (0 ~ DEBOUNCE_MAX_PORTS-1)
+ * @param portReg   PORTx 暫存器 (例: PORTB)
+ * @param pinMask   參與去彈跳的腳位
+ * @param activeLow 低電位有效的腳位
+ *
+ * 以目前腳位狀態作為初始穩定狀態，啟動時不會產生假事件
+ */
+#define debounceAddPort(index, portReg, pinMask, activeLow)                     \
+    debouncePorts[index].mask = pinMask;                                        \
+    debouncePorts[index].invert = activeLow;                                    \
+    debouncePorts[index].state = (byte)(((portReg) ^ (activeLow)) & (pinMask)); \
+    debouncePorts[index].count0 = 0xFF;                                         \
+    debouncePorts[index].count1 = 0xFF;                                         \
+    debouncePorts[index].gap = 0;                                               \
+    debouncePorts[index].port = &(portReg)
+
+/**
+ * _debouncePush() - 將事件寫入佇列 (由 debounceTick 呼叫)
+ */
+void _debouncePush(byte event) {
+    if ((byte)(debounceQueueHead - debounceQueueTail) < DEBOUNCE_QUEUE_SIZE) {
+        debounceQueue[debounceQueueHead & (DEBOUNCE_QUEUE_SIZE - 1)] = event;
+        debounceQueueHead++;
+    } else if (debounceDropped != 255) {
+        debounceDropped++;
+    }
+}
+
+/**
+ * debounceTick() - 取樣所有連接埠並產生事件 (在週期性中斷中呼叫)
+ *
+ * 只有狀態改變、按住中或雙擊判斷中的腳位才逐一處理
+ */
+void debounceTick() {
+    for (byte i = 0; i < DEBOUNCE_MAX_PORTS; i++) {
+        DebouncePort *p = &debouncePorts[i];
+        if (!p->port)
+            continue;
+        byte changed = (byte)(p->state ^ ((*p->port ^ p->invert) & p->mask));
+        p->count0 = (byte)~(p->count0 & changed);          // 相同時重設，不同時計數
+        p->count1 = (byte)(p->count0 ^ (p->count1 & changed));
+        changed &= p->count0 & p->count1;                  // 連續 4 次不同後溢位
+        p->state ^= changed;
+
+        byte active = changed | p->state | p->gap;
+        if (!active)
+            continue;
+        byte *hold = &debounceHold[i * 8];
+        for (byte pin = 0, mask = 1; pin < 8; pin++, mask <<= 1, hold++) {
+            if (!(active & mask))
+                continue;
+            byte key = (byte)(i * 8 + pin);
+            if (changed & mask) {
+                if (p->state & mask) {
+                    _debouncePush(DEBOUNCE_EVENT_PRESS | key);
+                    if (p->gap & mask)
+                        _debouncePush(DEBOUNCE_EVENT_DOUBLE_CLICK | key);
+                    p->gap &= (byte)~mask;
+                } else {
+                    _debouncePush(DEBOUNCE_EVENT_RELEASE | key);
+                    p->gap |= mask;
+                }
+                *hold = 0;
+            } else if (*hold != 255) {
+                (*hold)++;
+            }
+            if ((p->state & mask) && *hold == DEBOUNCE_LONG_PRESS_TICKS)
+                _debouncePush(DEBOUNCE_EVENT_LONG_PRESS | key);
+            if ((p->gap & mask) && *hold >= DEBOUNCE_DOUBLE_CLICK_TICKS)
+                p->gap &= (byte)~mask;
+        }
+    }
+}
+
+/**
+ * debounceRead() - 從佇列取出一個事件
+ * @return  事件 (DEBOUNCE_EVENT_x | 按鍵編號)，佇列為空時回傳 DEBOUNCE_EVENT_NONE
+ */
+byte debounceRead() {
+    if (debounceQueueHead == debounceQueueTail)
+        return DEBOUNCE_EVENT_NONE;
+    byte event = debounceQueue[debounceQueueTail & (DEBOUNCE_QUEUE_SIZE - 1)];
+    debounceQueueTail++;
+    return event;
+}
+
+#define debounceState(index) debouncePorts[index].state  // 去彈跳後的腳位狀態 (1 = 按下)
+#pragma endregion Debounce
+
+/* ========== 矩陣鍵盤 / Matrix Keypad ========== */
+#pragma region Keypad
+/**
+ * 4×4 ~ 4×8 矩陣鍵盤，列 (row) 接 RB4-RB7，行 (column) 接可設定的埠
+ *
+ * - 閒置時所有行輸出低電位，列使用 PORTB 內部上拉，等待 RB 狀態改變中斷，不佔用 CPU
+ * - 有按鍵按下後關閉 RB 中斷，由 keypadTick() 在定時中斷中逐行掃描，直到所有按鍵放開
+ * - 每次 keypadTick() 讀取上一次驅動的行並改驅動下一行，穩定時間為一個節拍，中斷中不需延遲等待；
+ *   KEYPAD_COLUMNS 個節拍完成一輪掃描
+ * - 掃描時只有目前的行設為輸出，其他行為高阻抗，多鍵同時按下時不會造成輸出短路
+ * - 以點陣記錄每個按鍵 (n-key rollover)，連續兩次掃描相同才改變狀態
+ *   沒有二極體的鍵盤同時按下 3 個構成直角的按鍵時會產生鬼鍵
+ * - 按下與放開事件寫入佇列，按鍵編號 = 行 × 4 + 列
+ *
+ * 注意: RB4-RB7 由鍵盤使用，不可與正交編碼器同時使用
+ */
+
+/* 行所在的埠、起始位元與行數 (1-8)，可在 include 前定義覆蓋 */
+#ifndef KEYPAD_COLUMN_PORT
+#define KEYPAD_COLUMN_PORT D
+#endif
+#ifndef KEYPAD_COLUMN_FIRST
+#define KEYPAD_COLUMN_FIRST 0
+#endif
+#ifndef KEYPAD_COLUMNS
+#define KEYPAD_COLUMNS 4
+#endif
+#ifndef KEYPAD_QUEUE_SIZE
+#define KEYPAD_QUEUE_SIZE 8
+#endif
+/* 按鍵編號對應的字元 (依行排列，每行 4 個，至少 KEYPAD_COLUMNS × 4 個)，預設為標準 4×4 鍵盤 */
+#ifndef KEYPAD_KEYMAP
+#define KEYPAD_KEYMAP "147*2580369#ABCD"
+#endif
+
+#if (KEYPAD_COLUMNS < 1) || (KEYPAD_COLUMN_FIRST + KEYPAD_COLUMNS > 8)
+#error "KEYPAD_COLUMNS" 與 "KEYPAD_COLUMN_FIRST" 必須位於同一個 8 位元埠內
+#endif
+#if (KEYPAD_QUEUE_SIZE & (KEYPAD_QUEUE_SIZE - 1)) || (KEYPAD_QUEUE_SIZE > 128)
+#error "KEYPAD_QUEUE_SIZE" 必須為 2 的冪次且不可超過 128
+#endif
+
+#define KEYPAD_KEYS (KEYPAD_COLUMNS * 4)                                                   // 按鍵數量
+#define KEYPAD_COLUMN_MASK ((byte)(((1 << KEYPAD_COLUMNS) - 1) << KEYPAD_COLUMN_FIRST))  // 行腳位遮罩
+#define _KEYPAD_TRIS MACRO_CODE_XCONCAT(TRIS, KEYPAD_COLUMN_PORT)
+#define _KEYPAD_LAT MACRO_CODE_XCONCAT(LAT, KEYPAD_COLUMN_PORT)
+#define _KEYPAD_COLUMN_FIRST_BIT ((byte)(1 << KEYPAD_COLUMN_FIRST))
+#define _KEYPAD_COLUMN_LAST_BIT ((byte)(1 << (KEYPAD_COLUMN_FIRST + KEYPAD_COLUMNS - 1)))
+
+/* 事件編碼: bit 7 = 放開，低 5 位元為按鍵編號 */
+#define KEYPAD_EVENT_RELEASE 0x80  // 放開 (未設定時為按下)
+#define KEYPAD_EVENT_NONE 0xFF     // 佇列為空
+
+#define keypadEventKey(event) ((event) & 0x1F)                // 取得按鍵編號
+#define keypadEventPressed(event) (!((event) & 0x80))         // 是否為按下事件
+#define keypadKeyChar(key) (keypadKeymap[(key) & 0x1F])       // 按鍵編號對應的字元
+
+const char keypadKeymap[] = KEYPAD_KEYMAP;
+_Static_assert(sizeof(keypadKeymap) - 1 >= KEYPAD_KEYS, "KEYPAD_KEYMAP shorter than KEYPAD_COLUMNS * 4");
+
+uint32_t keypadState;            // 去彈跳後的按鍵點陣 (bit = 行 × 4 + 列，1 = 按下)
+uint32_t _keypadLastRaw;         // 上一輪掃描的原始點陣
+uint32_t _keypadRaw;             // 本輪掃描中的原始點陣
+byte _keypadColumn;              // 目前驅動的行 (位元)
+volatile bool keypadScanning;    // 正在定時掃描 (有按鍵按下)
+byte keypadQueue[KEYPAD_QUEUE_SIZE];
+volatile byte keypadQueueHead;   // 寫入位置 (中斷)
+volatile byte keypadQueueTail;   // 讀取位置 (主程式)
+volatile byte keypadDropped;     // 佇列已滿而丟棄的事件數 (飽和於 255)
+
+/* 只驅動指定的行 (LAT 已為 0)，其他行為高阻抗 */
+#define _keypadDrive(column) _KEYPAD_TRIS = (byte)((_KEYPAD_TRIS | KEYPAD_COLUMN_MASK) & ~(column))
+
+/**
+ * _keypadIdle() - 回到閒置狀態: 所有行輸出低電位，啟用 RB 狀態改變中斷
+ *
+ * 讀取 PORTB 以結束不相符狀態後才能清除 RBIF
+ * 只在沒有按鍵按下時呼叫，列電位不受行切換影響，不需等待穩定
+ */
+void _keypadIdle() {
+    _KEYPAD_LAT &= (byte)~KEYPAD_COLUMN_MASK;
+    _KEYPAD_TRIS &= (byte)~KEYPAD_COLUMN_MASK;
+    (void)PORTB;
+    clearInterrupt_RBPortChange();
+    INTCONbits.RBIE = 0b1;
+}
+
+/**
+ * keypadBegin() - 初始化鍵盤
+ * @param priority  RB 狀態改變中斷優先權 (1=高, 0=低)
+ */
+#define keypadBegin(priority)            \
+    TRISB |= 0xF0;                       \
+    setPortBPullup(PORTB_PULLUP_ENABLE); \
+    INTCON2bits.RBIP = priority;         \
+    keypadState = 0;                     \
+    _keypadLastRaw = 0;                  \
+    keypadScanning = false;              \
+    keypadQueueHead = 0;                 \
+    keypadQueueTail = 0;                 \
+    keypadDropped = 0;                   \
+    _keypadIdle()
+
+/**
+ * processKeypad() - 處理 RB 狀態改變中斷 (在中斷中呼叫)
+ * @return  true = 已處理鍵盤中斷, false = 非鍵盤中斷
+ *
+ * 只關閉 RB 中斷並驅動第一行，實際讀取由 keypadTick() 進行
+ */
+bool processKeypad() {
+    if (!INTCONbits.RBIE || !interruptByRBPortChange())
+        return false;
+    (void)PORTB;
+    clearInterrupt_RBPortChange();
+    INTCONbits.RBIE = 0b0;
+    _keypadColumn = _KEYPAD_COLUMN_FIRST_BIT;
+    _keypadRaw = 0;
+    _keypadDrive(_KEYPAD_COLUMN_FIRST_BIT);
+    keypadScanning = true;
+    return true;
+}
+
+/**
+ * keypadTick() - 掃描鍵盤 (在 1-5ms 週期中斷中呼叫，一輪掃描需 KEYPAD_COLUMNS 個節拍)
+ *
+ * 閒置時立即返回，有按鍵時讀取目前驅動的行 (RB4-RB7) 後改驅動下一行，下一次呼叫時讀取
+ * 每行的 4 個列位元由高位移入，一輪完成後行 c 位於 bit c×4 ~ c×4+3，不需變動位移量
+ */
+void keypadTick() {
+    if (!keypadScanning)
+        return;
+    byte rows = (byte)(~PORTB >> 4) & 0x0F;
+    _keypadRaw = (_keypadRaw >> 4) | ((uint32_t)rows << ((KEYPAD_COLUMNS - 1) * 4));
+    if (_keypadColumn != _KEYPAD_COLUMN_LAST_BIT) {
+        _keypadColumn <<= 1;
+        _keypadDrive(_keypadColumn);
+        return;
+    }
+    uint32_t raw = _keypadRaw;
+    _keypadRaw = 0;
+
+    // 連續兩次相同才改變: 兩次皆按下則設定，兩次皆放開則清除
+    uint32_t state = (keypadState & (raw | _keypadLastRaw)) | (raw & _keypadLastRaw);
+    uint32_t changed = state ^ keypadState;
+    _keypadLastRaw = raw;
+    keypadState = state;
+
+    if (changed) {
+        uint32_t mask = 1;
+        for (byte key = 0; key < KEYPAD_KEYS; key++, mask <<= 1) {
+            if (!(changed & mask))
+                continue;
+            if ((byte)(keypadQueueHead - keypadQueueTail) < KEYPAD_QUEUE_SIZE) {
+                keypadQueue[keypadQueueHead & (KEYPAD_QUEUE_SIZE - 1)] = (state & mask) ? key : (key | KEYPAD_EVENT_RELEASE);
+                keypadQueueHead++;
+            } else if (keypadDropped != 255) {
+                keypadDropped++;
+            }
+        }
+    }
+
+    if (!state && !raw) {
+        keypadScanning = false;
+        _keypadIdle();
+    } else {
+        _keypadColumn = _KEYPAD_COLUMN_FIRST_BIT;
+        _keypadDrive(_KEYPAD_COLUMN_FIRST_BIT);
+    }
+}
+
+/**
+ * keypadRead() - 從佇列取出一個事件
+ * @return  事件 (按鍵編號 | KEYPAD_EVENT_RELEASE)，佇列為空時回傳 KEYPAD_EVENT_NONE
+ */
+byte keypadRead() {
+    if (keypadQueueHead == keypadQueueTail)
+        return KEYPAD_EVENT_NONE;
+    byte event = keypadQueue[keypadQueueTail & (KEYPAD_QUEUE_SIZE - 1)];
+    keypadQueueTail++;
+    return event;
+}
+
+#define keypadIsPressed(key) ((keypadState >> (key)) & 1)  // 按鍵目前是否按下
+#pragma endregion Keypad
+
+/* ========== 正交編碼器 / Quadrature Encoder ========== */
+#pragma region Quadrature
+/**
+ * 以 RB 狀態改變中斷解碼旋轉編碼器，編碼器 0 接 RB4 (B) / RB5 (A)，編碼器 1 接 RB6 (B) / RB7 (A)
+ *
+ * - 中斷只讀取一次 PORTB，以 (舊 AB << 2 | 新 AB) 查 16 項狀態轉移表得到 -1 / 0 / +1
+ *   沒有條件分支判斷方向，每次中斷的執行時間固定
+ * - 兩個腳位同時改變 (跳過一個狀態) 時查表結果為 0，不計數
+ * - 每次計數記錄時間戳 (與 micros() 相同時基)，由主程式計算速度
+ *
+ * 注意: RB4-RB7 由編碼器使用，不可與矩陣鍵盤同時使用；速度估算需要系統時間 (clockBegin)
+ *       RB 中斷優先權必須不低於 Timer1 (系統時間)，否則讀取 32 位元 clockMicros 時可能被溢位中斷打斷而讀到錯誤值
+ */
+
+/* 編碼器數量 (1-2) 與位置計數型別 (int16_t / int32_t)，可在 include 前定義覆蓋 */
+#ifndef QUADRATURE_ENCODERS
+#define QUADRATURE_ENCODERS 1
+#endif
+#ifndef QUADRATURE_POSITION_TYPE
+#define QUADRATURE_POSITION_TYPE int32_t
+#endif
+/* 超過此時間 (微秒 µs) 沒有計數時速度視為 0 */
+#ifndef QUADRATURE_VELOCITY_TIMEOUT
+#define QUADRATURE_VELOCITY_TIMEOUT 500000
+#endif
+
+#if (QUADRATURE_ENCODERS < 1) || (QUADRATURE_ENCODERS > 2)
+#error "QUADRATURE_ENCODERS" 只能為 1 或 2
+#endif
+
+/**
+ * 狀態轉移表，索引 = (舊 AB << 2) | 新 AB
+ * 00 -> 01 -> 11 -> 10 -> 00 為 -1 方向，反向為 +1，其餘 (不變或跳過) 為 0
+ */
+const int8_t quadratureTable[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+
+typedef struct {
+    volatile QUADRATURE_POSITION_TYPE position;  // 目前位置 (計數)
+    byte state;                                  // 上一次的 AB 狀態
+#ifdef CLOCK_TIMER1_PRESCALE
+    volatile uint32_t edgeMicros;          // 最後一次計數的時間
+    QUADRATURE_POSITION_TYPE lastPosition;  // 上一次計算速度時的位置
+    uint32_t lastMicros;                    // 上一次計算速度時的最後計數時間
+    int32_t velocity;                       // 最近一次的速度 (計數/秒)
+#endif
+} QuadratureEncoder;
+
+QuadratureEncoder quadratureEncoders[QUADRATURE_ENCODERS];
+
+/**
+ * quadratureBegin() - 初始化編碼器並啟用 RB 狀態改變中斷
+ * @param priority  中斷優先權 (1=高, 0=低)
+ *
+ * 啟用 PORTB 內部上拉，以目前腳位狀態作為初始狀態
+ */
+#define quadratureBegin(priority)                                                  \
+    TRISB |= 0xF0;                                                                 \
+    setPortBPullup(PORTB_PULLUP_ENABLE);                                           \
+    for (byte _encoder = 0; _encoder < QUADRATURE_ENCODERS; _encoder++) {          \
+        quadratureEncoders[_encoder].position = 0;                                 \
+        quadratureEncoders[_encoder].state = (PORTB >> (4 + _encoder * 2)) & 0b11; \
+    }                                                                              \
+    enableInterrupt_RBPortChange(priority)
+
+#ifdef CLOCK_TIMER1_PRESCALE
+/**
+ * _quadratureStep() - 更新一個編碼器 (由 processQuadrature 呼叫)
+ */
+#define _quadratureStep(encoder, ab, now)                            \
+    {                                                                \
+        int8_t step = quadratureTable[(encoder)->state << 2 | (ab)]; \
+        (encoder)->state = (ab);                                     \
+        (encoder)->position += step;                                 \
+        if (step)                                                    \
+            (encoder)->edgeMicros = now;                             \
+    }
+#else
+#define _quadratureStep(encoder, ab, now)                            \
+    {                                                                \
+        int8_t step = quadratureTable[(encoder)->state << 2 | (ab)]; \
+        (encoder)->state = (ab);                                     \
+        (encoder)->position += step;                                 \
+    }
+#endif
+
+/**
+ * processQuadrature() - 處理 RB 狀態改變中斷 (在中斷中呼叫)
+ * @return  true = 已處理 RB 狀態改變中斷, false = 非 RB 狀態改變中斷
+ *
+ * 讀取 PORTB 同時結束不相符狀態，之後才能清除 RBIF
+ * 時間戳直接讀取 TMR1 與累計微秒，不使用 micros() 的重讀迴圈 (RB 優先權不低於 Timer1 時不會被溢位中斷打斷)
+ * 未啟用 CLOCK_SCALING 時微秒位移為編譯期常數，執行時間固定
+ */
+bool processQuadrature() {
+    if (!interruptByRBPortChange())
+        return false;
+    byte port = PORTB;
+    clearInterrupt_RBPortChange();
+    uint32_t now = 0;
+#ifdef CLOCK_TIMER1_PRESCALE
+    uint16_t low = TMR1;
+    now = clockMicros + ((uint32_t)low << clockMicrosShift);
+    if (interruptByTimer1Overflow() && !(low & 0x8000))
+        now += clockOverflowUs;
+#endif
+    _quadratureStep(&quadratureEncoders[0], (port >> 4) & 0b11, now);
+#if (QUADRATURE_ENCODERS > 1)
+    _quadratureStep(&quadratureEncoders[1], port >> 6, now);
+#endif
+    (void)now;
+    return true;
+}
+
+/**
+ * quadratureRead() - 讀取編碼器位置
+ * @param encoder  編碼器編號 (0-1)
+ * @return         位置 (計數)
+ *
+ * 讀取多位元組位置時暫時關閉 RB 狀態改變中斷
+ */
+QUADRATURE_POSITION_TYPE quadratureRead(byte encoder) {
+    bool rbie = INTCONbits.RBIE;
+    INTCONbits.RBIE = 0b0;
+    QUADRATURE_POSITION_TYPE position = quadratureEncoders[encoder].position;
+    INTCONbits.RBIE = rbie;
+    return position;
+}
+
+/**
+ * quadratureWrite() - 設定編碼器位置 (歸零或校正)
+ * @param encoder   編碼器編號 (0-1)
+ * @param position  新位置
+ */
+void quadratureWrite(byte encoder, QUADRATURE_POSITION_TYPE position) {
+    bool rbie = INTCONbits.RBIE;
+    INTCONbits.RBIE = 0b0;
+    quadratureEncoders[encoder].position = position;
+#ifdef CLOCK_TIMER1_PRESCALE
+    quadratureEncoders[encoder].lastPosition = position;
+#endif
+    INTCONbits.RBIE = rbie;
+}
+
+#ifdef CLOCK_TIMER1_PRESCALE
+/**
+ * quadratureVelocity() - 估算編碼器速度
+ * @param encoder  編碼器編號 (0-1)
+ * @return         速度 (計數/秒，正負表示方向)
+ *
+ * 以上次呼叫後的位置變化除以兩次「最後計數時間」的間隔:
+ * 時間取自計數發生的瞬間而非呼叫時間，低速時也不會因呼叫週期產生量化誤差
+ * 期間沒有計數時保留上次速度，超過 QUADRATURE_VELOCITY_TIMEOUT 後歸零
+ */
+int32_t quadratureVelocity(byte encoder) {
+    QuadratureEncoder *e = &quadratureEncoders[encoder];
+    bool rbie = INTCONbits.RBIE;
+    INTCONbits.RBIE = 0b0;
+    QUADRATURE_POSITION_TYPE position = e->position;
+    uint32_t edge = e->edgeMicros;
+    INTCONbits.RBIE = rbie;
+
+    int32_t delta = (int32_t)(QUADRATURE_POSITION_TYPE)(position - e->lastPosition);
+    if (delta) {
+        uint32_t elapsed = edge - e->lastMicros;
+        if (elapsed) {
+            if (delta < 2000 && delta > -2000) {
+                e->velocity = delta * 1000000 / (int32_t)elapsed;
+            } else {
+                uint32_t ms = (elapsed + 500) / 1000;  // 避免 delta × 10^6 溢位，改以毫秒計算
+                e->velocity = delta * 1000 / (int32_t)(ms ? ms : 1);
+            }
+        }
+        e->lastPosition = position;
+        e->lastMicros = edge;
+    } else if (micros() - edge > QUADRATURE_VELOCITY_TIMEOUT) {
+        e->velocity = 0;
+        e->lastMicros = edge;
+    }
+    return e->velocity;
+}
+#endif
+#pragma endregion Quadrature
+
+/* ========== 多工顯示器 / Multiplexed Display ========== */
+#pragma region Display
+/**
+ * 多工 7 段顯示器 / LED 矩陣驅動，由定時中斷更新，更新率不受主迴圈影響
+ *
+ * - 段 (a-g, dp) 接 DISPLAY_SEGMENT_PORT 的 8 個腳位，位數選擇接 DISPLAY_DIGIT_PORT 的連續腳位
+ * - 畫面緩衝區 displayBuffer[] 每個位數一個位元組 (bit 0-6 = a-g, bit 7 = dp)
+ * - displayTick() 每次中斷最多兩次暫存器寫入: 切換位數時先關閉選擇線、寫入段、再選擇新位數 (避免殘影)
+ * - 每個位數顯示 DISPLAY_BRIGHTNESS_MAX 個節拍，前 displayBrightness[i] 個節拍點亮，以點亮時間調整亮度
+ * - LED 矩陣: 位數 = 列，段 = 行，每列 8 顆 LED
+ *
+ * 更新率 = 1 / (節拍週期 × DISPLAY_BRIGHTNESS_MAX × DISPLAY_DIGITS)
+ * 例: 250µs 節拍、8 級亮度、4 位數 = 125 Hz
+ */
+
+/* 段與位數選擇所在的埠、位數數量與亮度級數，可在 include 前定義覆蓋 */
+#ifndef DISPLAY_SEGMENT_PORT
+#define DISPLAY_SEGMENT_PORT D
+#endif
+#ifndef DISPLAY_DIGIT_PORT
+#define DISPLAY_DIGIT_PORT B
+#endif
+#ifndef DISPLAY_DIGIT_FIRST
+#define DISPLAY_DIGIT_FIRST 0
+#endif
+#ifndef DISPLAY_DIGITS
+#define DISPLAY_DIGITS 4
+#endif
+#ifndef DISPLAY_BRIGHTNESS_MAX
+#define DISPLAY_BRIGHTNESS_MAX 8
+#endif
+/* 共陽極 (段低電位點亮) 或以 PNP 電晶體選擇位數時設為 1 */
+#ifndef DISPLAY_SEGMENT_ACTIVE_LOW
+#define DISPLAY_SEGMENT_ACTIVE_LOW 0
+#endif
+#ifndef DISPLAY_DIGIT_ACTIVE_LOW
+#define DISPLAY_DIGIT_ACTIVE_LOW 0
+#endif
+
+#if (DISPLAY_DIGITS < 1) || (DISPLAY_DIGIT_FIRST + DISPLAY_DIGITS > 8)
+#error "DISPLAY_DIGITS" 與 "DISPLAY_DIGIT_FIRST" 必須位於同一個 8 位元埠內
+#endif
+
+#define DISPLAY_DIGIT_MASK ((byte)(((1 << DISPLAY_DIGITS) - 1) << DISPLAY_DIGIT_FIRST))  // 位數選擇遮罩
+#define _DISPLAY_SEGMENT_LAT MACRO_CODE_XCONCAT(LAT, DISPLAY_SEGMENT_PORT)
+#define _DISPLAY_SEGMENT_TRIS MACRO_CODE_XCONCAT(TRIS, DISPLAY_SEGMENT_PORT)
+#define _DISPLAY_DIGIT_LAT MACRO_CODE_XCONCAT(LAT, DISPLAY_DIGIT_PORT)
+#define _DISPLAY_DIGIT_TRIS MACRO_CODE_XCONCAT(TRIS, DISPLAY_DIGIT_PORT)
+#define _DISPLAY_SEGMENT_INVERT (DISPLAY_SEGMENT_ACTIVE_LOW ? 0xFF : 0x00)
+#define _DISPLAY_DIGIT_OFF (DISPLAY_DIGIT_ACTIVE_LOW ? DISPLAY_DIGIT_MASK : 0x00)
+
+/* 7 段字型 (bit 0-6 = a-g)，const 陣列存放於程式記憶體 */
+#define DISPLAY_CHAR_BLANK 16  // 空白
+#define DISPLAY_CHAR_MINUS 17  // 負號
+#define DISPLAY_SEGMENT_DP 0x80  // 小數點
+
+const byte displayFont[18] = {
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,  // 0-7
+    0x7F, 0x6F, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71,  // 8-9, A-F
+    0x00, 0x40,                                      // 空白, 負號
+};
+
+byte displayBuffer[DISPLAY_DIGITS];      // 畫面緩衝區，displayBuffer[0] 為最左位數
+byte displayBrightness[DISPLAY_DIGITS];  // 各位數點亮節拍數 (0 ~ DISPLAY_BRIGHTNESS_MAX)
+byte _displayDigit;                      // 目前顯示的位數
+byte _displaySelect;                     // 目前位數的選擇線位元
+byte _displayPhase;                      // 目前位數已顯示的節拍數
+
+/**
+ * displayBegin() - 初始化顯示器 (清除畫面，亮度最大)
+ */
+#define displayBegin()                                                                          \
+    _DISPLAY_DIGIT_LAT = (_DISPLAY_DIGIT_LAT & (byte)~DISPLAY_DIGIT_MASK) | _DISPLAY_DIGIT_OFF; \
+    _DISPLAY_DIGIT_TRIS &= (byte)~DISPLAY_DIGIT_MASK;                                           \
+    _DISPLAY_SEGMENT_LAT = _DISPLAY_SEGMENT_INVERT;                                             \
+    _DISPLAY_SEGMENT_TRIS = 0x00;                                                               \
+    for (byte _digit = 0; _digit < DISPLAY_DIGITS; _digit++) {                                  \
+        displayBuffer[_digit] = 0;                                                              \
+        displayBrightness[_digit] = DISPLAY_BRIGHTNESS_MAX;                                     \
+    }                                                                                           \
+    _displayDigit = DISPLAY_DIGITS - 1;                                                         \
+    _displayPhase = 0
+
+/**
+ * displayTick() - 更新顯示器 (在固定週期中斷中呼叫，建議 100-500µs)
+ */
+void displayTick() {
+    if (_displayPhase == 0) {
+        _DISPLAY_DIGIT_LAT = (_DISPLAY_DIGIT_LAT & (byte)~DISPLAY_DIGIT_MASK) | _DISPLAY_DIGIT_OFF;
+        if (++_displayDigit >= DISPLAY_DIGITS) {
+            _displayDigit = 0;
+            _displaySelect = 1 << DISPLAY_DIGIT_FIRST;
+        } else {
+            _displaySelect <<= 1;
+        }
+        _DISPLAY_SEGMENT_LAT = displayBuffer[_displayDigit] ^ _DISPLAY_SEGMENT_INVERT;
+        if (displayBrightness[_displayDigit])
+            _DISPLAY_DIGIT_LAT = (_DISPLAY_DIGIT_LAT & (byte)~DISPLAY_DIGIT_MASK) | (_displaySelect ^ _DISPLAY_DIGIT_OFF);
+    } else if (_displayPhase == displayBrightness[_displayDigit]) {
+        _DISPLAY_DIGIT_LAT = (_DISPLAY_DIGIT_LAT & (byte)~DISPLAY_DIGIT_MASK) | _DISPLAY_DIGIT_OFF;
+    }
+    if (++_displayPhase >= DISPLAY_BRIGHTNESS_MAX)
+        _displayPhase = 0;
+}
+
+#define displaySetRaw(index, segments) displayBuffer[index] = segments           // 直接設定段圖樣 (LED 矩陣的一列)
+#define displaySetChar(index, value) displayBuffer[index] = displayFont[value]  // 以字型設定位數 (0-15, DISPLAY_CHAR_x)
+#define displaySetDecimalPoint(index, on) \
+    displayBuffer[index] = (on) ? displayBuffer[index] | DISPLAY_SEGMENT_DP : displayBuffer[index] & (byte)~DISPLAY_SEGMENT_DP
+#define displaySetBrightness(index, level) displayBrightness[index] = level  // 設定位數亮度 (0 ~ DISPLAY_BRIGHTNESS_MAX)
+
+/**
+ * displaySetAllBrightness() - 設定所有位數亮度
+ * @param level  0 (關閉) ~ DISPLAY_BRIGHTNESS_MAX
+ */
+void displaySetAllBrightness(byte level) {
+    for (byte i = 0; i < DISPLAY_DIGITS; i++)
+        displayBrightness[i] = level;
+}
+
+/**
+ * displayPrintNumber() - 以十進位靠右顯示數字
+ * @param value  數值，超出位數時只顯示低位數
+ *
+ * 先在區域變數組成整個畫面再寫入緩衝區，中斷不會顯示到一半的數字
+ */
+void displayPrintNumber(int16_t value) {
+    byte digits[DISPLAY_DIGITS];
+    bool negative = value < 0;
+    uint16_t number = negative ? (uint16_t)0 - (uint16_t)value : (uint16_t)value;  // -32768 也不會溢位
+    for (int8_t i = DISPLAY_DIGITS - 1; i >= 0; i--) {
+        if (number || i == DISPLAY_DIGITS - 1) {
+            digits[i] = displayFont[number % 10];
+            number /= 10;
+        } else if (negative) {
+            digits[i] = displayFont[DISPLAY_CHAR_MINUS];
+            negative = false;
+        } else {
+            digits[i] = displayFont[DISPLAY_CHAR_BLANK];
+        }
+    }
+    for (byte i = 0; i < DISPLAY_DIGITS; i++)
+        displayBuffer[i] = digits[i];
+}
+
+/**
+ * displayPrintHex() - 以十六進位顯示數字 (補零)
+ * @param value  數值
+ */
+void displayPrintHex(uint16_t value) {
+    for (int8_t i = DISPLAY_DIGITS - 1; i >= 0; i--) {
+        displayBuffer[i] = displayFont[value & 0x0F];
+        value >>= 4;
+    }
+}
+#pragma endregion Display
+
+/* ========== LED 動畫 / LED Animation ========== */
+#pragma region Animation
+/**
+ * 將存放於程式記憶體的幀序列播放到腳位群組
+ *
+ * - 動畫 (LedAnimation) 為 const 資料: 幀陣列、每幀節拍數、是否循環
+ * - 播放器 (AnimationPlayer) 綁定一個腳位群組，在定時中斷中呼叫 animationTick()
+ *   每個節拍只遞減計數，換幀時對 LATx 做一次遮罩寫入
+ * - 倍率 (scale) 將每幀節拍數乘上整數倍，同一份資料可用於不同速度
+ * - animationShow() 直接顯示指定的幀，用於以 ADC 等數值選擇圖樣
+ */
+
+typedef struct {
+    const byte *frames;  // 幀資料 (值的 bit 0 對應群組最低位元的腳位)
+    byte length;         // 幀數
+    byte period;         // 每幀節拍數
+    bool loop;           // 播放完畢後從頭循環
+} LedAnimation;
+
+/**
+ * LED_ANIMATION() - 以 const 幀陣列建立動畫
+ * @param frames  const byte 陣列
+ * @param period  每幀節拍數 (1-255)
+ * @param loop    是否循環
+ */
+#define LED_ANIMATION(frames, period, loop) {frames, sizeof(frames), period, loop}
+
+typedef struct {
+    volatile unsigned char *lat;   // 輸出的 LATx 暫存器
+    byte mask;                     // 群組遮罩
+    byte shift;                    // 群組位移
+    const LedAnimation *animation; // 目前動畫
+    byte frame;                    // 目前幀
+    uint16_t countdown;            // 距離下一幀的節拍數
+    byte scale;                    // 每幀節拍數倍率 (1 = 原速)
+    volatile bool running;         // 是否播放中
+} AnimationPlayer;
+
+/**
+ * animationBegin() - 將播放器綁定到腳位群組
+ * @param player  AnimationPlayer 變數
+ * @param group   腳位群組 (PIN_GROUP / PIN_GROUP_MASK)
+ */
+#define animationBegin(player, group) _animationBegin(player, group)
+#define _animationBegin(player, port, groupMask, groupShift) \
+    (player).lat = &MACRO_CODE_CONCAT(LAT, port);            \
+    (player).mask = groupMask;                               \
+    (player).shift = groupShift;                             \
+    (player).animation = NULL;                               \
+    (player).scale = 1;                                      \
+    (player).running = false
+
+#define animationSetScale(player, value) (player).scale = value  // 設定每幀節拍數倍率 (1-255)
+
+/**
+ * _animationWrite() - 以一次遮罩寫入輸出一幀
+ */
+void _animationWrite(AnimationPlayer *player, byte frame) {
+    *player->lat = (byte)((*player->lat & (byte)~player->mask) | ((byte)(frame << player->shift) & player->mask));
+}
+
+/**
+ * animationPlay() - 從第一幀開始播放動畫
+ * @param player     播放器
+ * @param animation  動畫
+ */
+void animationPlay(AnimationPlayer *player, const LedAnimation *animation) {
+    player->running = false;
+    player->animation = animation;
+    player->frame = 0;
+    player->countdown = (uint16_t)animation->period * player->scale;
+    _animationWrite(player, animation->frames[0]);
+    player->running = true;
+}
+
+#define animationStop(player) (player)->running = false  // 停止播放，保留目前輸出
+
+/**
+ * animationShow() - 停止播放並顯示指定的幀
+ * @param player     播放器
+ * @param animation  動畫
+ * @param frame      幀編號，超出範圍時顯示最後一幀
+ */
+void animationShow(AnimationPlayer *player, const LedAnimation *animation, byte frame) {
+    player->running = false;
+    if (frame >= animation->length)
+        frame = animation->length - 1;
+    _animationWrite(player, animation->frames[frame]);
+}
+
+/**
+ * animationTick() - 推進動畫 (在定時中斷中呼叫)
+ * @param player  播放器
+ */
+void animationTick(AnimationPlayer *player) {
+    if (!player->running || --player->countdown)
+        return;
+    const LedAnimation *animation = player->animation;
+    if (++player->frame >= animation->length) {
+        if (!animation->loop) {
+            player->running = false;
+            return;
+        }
+        player->frame = 0;
+    }
+    player->countdown = (uint16_t)animation->period * player->scale;
+    _animationWrite(player, animation->frames[player->frame]);
+}
+#pragma endregion Animation
+
+/* ========== 中斷分派表 / Interrupt Dispatch ========== */
+#pragma region InterruptDispatch
+/**
+ * 以註冊表產生高/低優先權中斷服務程式
+ *
+ * 在 #include "lib.h" 之前定義 INTERRUPT_TABLE(X)，每列 X(來源, 處理函式, 優先權)：
+ *
+ *   #define INTERRUPT_TABLE(X)                  \
+ *       X(TMR3, onDebounceTick, INTERRUPT_HIGH) \
+ *       X(AD, onADConverter, INTERRUPT_HIGH)    \
+ *       X(RC, onSerialReceive, INTERRUPT_LOW)
+ *
+ * - 來源: INT0 INT1 INT2 RB TMR0 TMR1 TMR2 TMR3 AD RC TX CCP1 CCP2 EE BCL
+ *   (EE、BCL 未用於 EEPROM / I2C 時可由軟體設定旗標觸發，見 Kernel)
+ * - 同一優先權內依表中順序檢查，越前面延遲越短
+ * - 每次進入中斷只讀取一次 INTCON / INTCON3 / PIR1 / PIR2，並與致能位元及
+ *   已註冊來源的常數遮罩相與；沒有來源使用的暫存器不會被讀取
+ * - 處理函式 void f(void) 負責清除自己的旗標 (與手寫 ISR 相同)
+ * - interruptDispatchBegin() 依表設定 IPEN、各來源優先權並致能中斷 (TX 只設定
+ *   優先權且保持關閉: TXREG 為空時 TXIF 恆為 1，註冊 TX 處理函式的程式須在有資料
+ *   要送時以 enableInterrupt_TransmitUART() 開啟，送完後自行清除 PIE1bits.TXIE)
+ * - INTERRUPT_DISPATCH() 放在所有處理函式之後，展開為兩個 ISR
+ * - INTERRUPT_HIGH_LATENCY / INTERRUPT_LOW_LATENCY 為編譯期估算的最壞分派延遲
+ *   (指令週期，中斷發生到最後一個來源的處理函式開始執行，不含其他處理函式的執行時間)；
+ *   定義 INTERRUPT_REPORT_LATENCY 時以 #pragma message 在編譯時輸出，定義 INTERRUPT_LATENCY_LIMIT 時超過即編譯失敗
+ */
+
+#define INTERRUPT_HIGH 1  // 高優先權 (0x0008)
+#define INTERRUPT_LOW 0   // 低優先權 (0x0018)
+
+/**
+ * INTERRUPT_ENTRY_CYCLES - 進入中斷的固定成本 (指令週期)
+ *
+ * 硬體向量延遲 3-4 週期加上編譯器保存內容；依 .lst 中 ISR 開頭的指令數調整
+ */
+#ifndef INTERRUPT_ENTRY_CYCLES
+#define INTERRUPT_ENTRY_CYCLES 24
+#endif
+
+/* 旗標暫存器編號 */
+#define _INTERRUPT_INTCON 0
+#define _INTERRUPT_INTCON3 1
+#define _INTERRUPT_PIR1 2
+#define _INTERRUPT_PIR2 3
+
+/* 各來源: 旗標暫存器、位元遮罩、啟用方式、編號 (INTCON / INTCON3 的致能位元在旗標位元左移 3 位) */
+#define _INTERRUPT_REG_INT0 _INTERRUPT_INTCON
+#define _INTERRUPT_BIT_INT0 0x02
+#define _INTERRUPT_SETUP_INT0(priority) enableInterrupt_RB0External()
+#define _INTERRUPT_ID_INT0 0
+#define _INTERRUPT_REG_INT1 _INTERRUPT_INTCON3
+#define _INTERRUPT_BIT_INT1 0x01
+#define _INTERRUPT_SETUP_INT1(priority) enableInterrupt_RB1External(priority)
+#define _INTERRUPT_ID_INT1 1
+#define _INTERRUPT_REG_INT2 _INTERRUPT_INTCON3
+#define _INTERRUPT_BIT_INT2 0x02
+#define _INTERRUPT_SETUP_INT2(priority) enableInterrupt_RB2External(priority)
+#define _INTERRUPT_ID_INT2 2
+#define _INTERRUPT_REG_RB _INTERRUPT_INTCON
+#define _INTERRUPT_BIT_RB 0x01
+#define _INTERRUPT_SETUP_RB(priority) enableInterrupt_RBPortChange(priority)
+#define _INTERRUPT_ID_RB 3
+#define _INTERRUPT_REG_TMR0 _INTERRUPT_INTCON
+#define _INTERRUPT_BIT_TMR0 0x04
+#define _INTERRUPT_SETUP_TMR0(priority) enableInterrupt_Timer0Overflow(priority)
+#define _INTERRUPT_ID_TMR0 4
+#define _INTERRUPT_REG_TMR1 _INTERRUPT_PIR1
+#define _INTERRUPT_BIT_TMR1 0x01
+#define _INTERRUPT_SETUP_TMR1(priority) enableInterrupt_Timer1Overflow(priority)
+#define _INTERRUPT_ID_TMR1 5
+#define _INTERRUPT_REG_TMR2 _INTERRUPT_PIR1
+#define _INTERRUPT_BIT_TMR2 0x02
+#define _INTERRUPT_SETUP_TMR2(priority) enableInterrupt_Timer2PR2(priority)
+#define _INTERRUPT_ID_TMR2 6
+#define _INTERRUPT_REG_TMR3 _INTERRUPT_PIR2
+#define _INTERRUPT_BIT_TMR3 0x02
+#define _INTERRUPT_SETUP_TMR3(priority) enableInterrupt_Timer3Overflow(priority)
+#define _INTERRUPT_ID_TMR3 7
+#define _INTERRUPT_REG_AD _INTERRUPT_PIR1
+#define _INTERRUPT_BIT_AD 0x40
+#define _INTERRUPT_SETUP_AD(priority) enableInterrupt_ADConverter(priority)
+#define _INTERRUPT_ID_AD 8
+#define _INTERRUPT_REG_RC _INTERRUPT_PIR1
+#define _INTERRUPT_BIT_RC 0x20
+#define _INTERRUPT_SETUP_RC(priority) enableInterrupt_ReceiveUART(priority)
+#define _INTERRUPT_ID_RC 9
+#define _INTERRUPT_REG_TX _INTERRUPT_PIR1
+#define _INTERRUPT_BIT_TX 0x10
+#define _INTERRUPT_SETUP_TX(priority) IPR1bits.TXIP = priority  // TXIE 由處理函式的擁有者開關
+#define _INTERRUPT_ID_TX 10
+#define _INTERRUPT_REG_CCP1 _INTERRUPT_PIR1
+#define _INTERRUPT_BIT_CCP1 0x04
+#define _INTERRUPT_SETUP_CCP1(priority) enableInterrupt_CCP1(priority)
+#define _INTERRUPT_ID_CCP1 11
+#define _INTERRUPT_REG_CCP2 _INTERRUPT_PIR2
+#define _INTERRUPT_BIT_CCP2 0x01
+#define _INTERRUPT_SETUP_CCP2(priority) enableInterrupt_CCP2(priority)
+#define _INTERRUPT_ID_CCP2 12
+#define _INTERRUPT_REG_EE _INTERRUPT_PIR2
+#define _INTERRUPT_BIT_EE 0x10
+#define _INTERRUPT_SETUP_EE(priority) enableInterrupt_EEPROMWrite(priority)
+#define _INTERRUPT_ID_EE 13
+#define _INTERRUPT_REG_BCL _INTERRUPT_PIR2
+#define _INTERRUPT_BIT_BCL 0x08
+#define _INTERRUPT_SETUP_BCL(priority) enableInterrupt_BusCollision(priority)
+#define _INTERRUPT_ID_BCL 14
+
+#ifdef INTERRUPT_TABLE
+/* 每個 (優先權, 暫存器) 組合的已註冊來源遮罩，可用於 #if */
+#define _interruptMaskIf(name, priority, reg, level) \
+    (((_INTERRUPT_REG_##name == reg) && ((priority) == level)) ? _INTERRUPT_BIT_##name : 0)
+#define _INTERRUPT_MASK_HIGH_INTCON(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_INTCON, INTERRUPT_HIGH)
+#define _INTERRUPT_MASK_HIGH_INTCON3(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_INTCON3, INTERRUPT_HIGH)
+#define _INTERRUPT_MASK_HIGH_PIR1(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_PIR1, INTERRUPT_HIGH)
+#define _INTERRUPT_MASK_HIGH_PIR2(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_PIR2, INTERRUPT_HIGH)
+#define _INTERRUPT_MASK_LOW_INTCON(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_INTCON, INTERRUPT_LOW)
+#define _INTERRUPT_MASK_LOW_INTCON3(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_INTCON3, INTERRUPT_LOW)
+#define _INTERRUPT_MASK_LOW_PIR1(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_PIR1, INTERRUPT_LOW)
+#define _INTERRUPT_MASK_LOW_PIR2(name, handler, priority) | _interruptMaskIf(name, priority, _INTERRUPT_PIR2, INTERRUPT_LOW)
+#define _interruptMask(level, reg) (0 INTERRUPT_TABLE(_INTERRUPT_MASK_##level##_##reg))
+
+#define _INTERRUPT_COUNT_HIGH(name, handler, priority) +((priority) == INTERRUPT_HIGH)
+#define _INTERRUPT_COUNT_LOW(name, handler, priority) +((priority) == INTERRUPT_LOW)
+#define _interruptCount(level) (0 INTERRUPT_TABLE(_INTERRUPT_COUNT_##level))
+
+/**
+ * 延遲估算: 進入成本 + 快照 (INTCON 類 7 週期: 讀取存放、移位、兩次 AND；PIR 類 4 週期: 讀取、AND PIE、AND 遮罩、存放)
+ *          + 前面每個未觸發的來源 2 週期 (btfsc 跳過) + 最後一個來源的 btfsc 與 call 3 週期
+ */
+#define _interruptLatency(level)                                                                                   \
+    (INTERRUPT_ENTRY_CYCLES + 7 * ((_interruptMask(level, INTCON) != 0) + (_interruptMask(level, INTCON3) != 0)) + \
+     4 * ((_interruptMask(level, PIR1) != 0) + (_interruptMask(level, PIR2) != 0)) +                               \
+     (_interruptCount(level) ? 2 * _interruptCount(level) + 1 : 0))
+#define INTERRUPT_HIGH_LATENCY _interruptLatency(HIGH)  // 高優先權最壞分派延遲 (指令週期)
+#define INTERRUPT_LOW_LATENCY _interruptLatency(LOW)    // 低優先權最壞分派延遲 (指令週期)
+
+#if _interruptMask(LOW, INTCON) & _INTERRUPT_BIT_INT0
+#error "INTERRUPT_TABLE: INT0 固定為高優先權"
+#endif
+#if (_interruptMask(HIGH, INTCON) & _interruptMask(LOW, INTCON)) || (_interruptMask(HIGH, INTCON3) & _interruptMask(LOW, INTCON3)) || \
+    (_interruptMask(HIGH, PIR1) & _interruptMask(LOW, PIR1)) || (_interruptMask(HIGH, PIR2) & _interruptMask(LOW, PIR2))
+#error "INTERRUPT_TABLE: 同一來源同時註冊為高與低優先權"
+#endif
+#ifdef INTERRUPT_LATENCY_LIMIT
+#if INTERRUPT_HIGH_LATENCY > INTERRUPT_LATENCY_LIMIT
+#error "INTERRUPT_TABLE: 高優先權分派延遲超過 INTERRUPT_LATENCY_LIMIT，減少高優先權來源或調整順序"
+#endif
+#if INTERRUPT_LOW_LATENCY > INTERRUPT_LATENCY_LIMIT
+#error "INTERRUPT_TABLE: 低優先權分派延遲超過 INTERRUPT_LATENCY_LIMIT"
+#endif
+#endif
+
+/* 定義 INTERRUPT_REPORT_LATENCY 時於編譯訊息輸出估算延遲；前置處理器無法直接輸出運算結果，逐位數轉為十進位 */
+#ifdef INTERRUPT_REPORT_LATENCY
+#if INTERRUPT_HIGH_LATENCY >= 100
+#pragma message("INTERRUPT_TABLE: 高優先權分派延遲 >= 100 指令週期")
+#else
+#if INTERRUPT_HIGH_LATENCY / 10 == 0
+#define _INTERRUPT_HIGH_LATENCY_TENS 0
+#elif INTERRUPT_HIGH_LATENCY / 10 == 1
+#define _INTERRUPT_HIGH_LATENCY_TENS 1
+#elif INTERRUPT_HIGH_LATENCY / 10 == 2
+#define _INTERRUPT_HIGH_LATENCY_TENS 2
+#elif INTERRUPT_HIGH_LATENCY / 10 == 3
+#define _INTERRUPT_HIGH_LATENCY_TENS 3
+#elif INTERRUPT_HIGH_LATENCY / 10 == 4
+#define _INTERRUPT_HIGH_LATENCY_TENS 4
+#elif INTERRUPT_HIGH_LATENCY / 10 == 5
+#define _INTERRUPT_HIGH_LATENCY_TENS 5
+#elif INTERRUPT_HIGH_LATENCY / 10 == 6
+#define _INTERRUPT_HIGH_LATENCY_TENS 6
+#elif INTERRUPT_HIGH_LATENCY / 10 == 7
+#define _INTERRUPT_HIGH_LATENCY_TENS 7
+#elif INTERRUPT_HIGH_LATENCY / 10 == 8
+#define _INTERRUPT_HIGH_LATENCY_TENS 8
+#elif INTERRUPT_HIGH_LATENCY / 10 == 9
+#define _INTERRUPT_HIGH_LATENCY_TENS 9
+#endif
+#if INTERRUPT_HIGH_LATENCY % 10 == 0
+#define _INTERRUPT_HIGH_LATENCY_UNITS 0
+#elif INTERRUPT_HIGH_LATENCY % 10 == 1
+#define _INTERRUPT_HIGH_LATENCY_UNITS 1
+#elif INTERRUPT_HIGH_LATENCY % 10 == 2
+#define _INTERRUPT_HIGH_LATENCY_UNITS 2
+#elif INTERRUPT_HIGH_LATENCY % 10 == 3
+#define _INTERRUPT_HIGH_LATENCY_UNITS 3
+#elif INTERRUPT_HIGH_LATENCY % 10 == 4
+#define _INTERRUPT_HIGH_LATENCY_UNITS 4
+#elif INTERRUPT_HIGH_LATENCY % 10 == 5
+#define _INTERRUPT_HIGH_LATENCY_UNITS 5
+#elif INTERRUPT_HIGH_LATENCY % 10 == 6
+#define _INTERRUPT_HIGH_LATENCY_UNITS 6
+#elif INTERRUPT_HIGH_LATENCY % 10 == 7
+#define _INTERRUPT_HIGH_LATENCY_UNITS 7
+#elif INTERRUPT_HIGH_LATENCY % 10 == 8
+#define _INTERRUPT_HIGH_LATENCY_UNITS 8
+#elif INTERRUPT_HIGH_LATENCY % 10 == 9
+#define _INTERRUPT_HIGH_LATENCY_UNITS 9
+#endif
+#pragma message("INTERRUPT_TABLE: 高優先權分派延遲 " MACRO_CODE_XSTRING(_INTERRUPT_HIGH_LATENCY_TENS) MACRO_CODE_XSTRING(_INTERRUPT_HIGH_LATENCY_UNITS) " 指令週期")
+#endif
+#if INTERRUPT_LOW_LATENCY >= 100
+#pragma message("INTERRUPT_TABLE: 低優先權分派延遲 >= 100 指令週期")
+#else
+#if INTERRUPT_LOW_LATENCY / 10 == 0
+#define _INTERRUPT_LOW_LATENCY_TENS 0
+#elif INTERRUPT_LOW_LATENCY / 10 == 1
+#define _INTERRUPT_LOW_LATENCY_TENS 1
+#elif INTERRUPT_LOW_LATENCY / 10 == 2
+#define _INTERRUPT_LOW_LATENCY_TENS 2
+#elif INTERRUPT_LOW_LATENCY / 10 == 3
+#define _INTERRUPT_LOW_LATENCY_TENS 3
+#elif INTERRUPT_LOW_LATENCY / 10 == 4
+#define _INTERRUPT_LOW_LATENCY_TENS 4
+#elif INTERRUPT_LOW_LATENCY / 10 == 5
+#define _INTERRUPT_LOW_LATENCY_TENS 5
+#elif INTERRUPT_LOW_LATENCY / 10 == 6
+#define _INTERRUPT_LOW_LATENCY_TENS 6
+#elif INTERRUPT_LOW_LATENCY / 10 == 7
+#define _INTERRUPT_LOW_LATENCY_TENS 7
+#elif INTERRUPT_LOW_LATENCY / 10 == 8
+#define _INTERRUPT_LOW_LATENCY_TENS 8
+#elif INTERRUPT_LOW_LATENCY / 10 == 9
+#define _INTERRUPT_LOW_LATENCY_TENS 9
+#endif
+#if INTERRUPT_LOW_LATENCY % 10 == 0
+#define _INTERRUPT_LOW_LATENCY_UNITS 0
+#elif INTERRUPT_LOW_LATENCY % 10 == 1
+#define _INTERRUPT_LOW_LATENCY_UNITS 1
+#elif INTERRUPT_LOW_LATENCY % 10 == 2
+#define _INTERRUPT_LOW_LATENCY_UNITS 2
+#elif INTERRUPT_LOW_LATENCY % 10 == 3
+#define _INTERRUPT_LOW_LATENCY_UNITS 3
+#elif INTERRUPT_LOW_LATENCY % 10 == 4
+#define _INTERRUPT_LOW_LATENCY_UNITS 4
+#elif INTERRUPT_LOW_LATENCY % 10 == 5
+#define _INTERRUPT_LOW_LATENCY_UNITS 5
+#elif INTERRUPT_LOW_LATENCY % 10 == 6
+#define _INTERRUPT_LOW_LATENCY_UNITS 6
+#elif INTERRUPT_LOW_LATENCY % 10 == 7
+#define _INTERRUPT_LOW_LATENCY_UNITS 7
+#elif INTERRUPT_LOW_LATENCY % 10 == 8
+#define _INTERRUPT_LOW_LATENCY_UNITS 8
+#elif INTERRUPT_LOW_LATENCY % 10 == 9
+#define _INTERRUPT_LOW_LATENCY_UNITS 9
+#endif
+#pragma message("INTERRUPT_TABLE: 低優先權分派延遲 " MACRO_CODE_XSTRING(_INTERRUPT_LOW_LATENCY_TENS) MACRO_CODE_XSTRING(_INTERRUPT_LOW_LATENCY_UNITS) " 指令週期")
+#endif
+#endif
+
+const uint16_t interruptHighLatency = INTERRUPT_HIGH_LATENCY;  // 供執行期輸出或除錯器檢視
+const uint16_t interruptLowLatency = INTERRUPT_LOW_LATENCY;
+
+/**
+ * interruptDispatchBegin() - 依註冊表設定優先權並致能所有來源
+ *
+ * 在各周邊初始化 (含會自行設定優先權的 xxxBegin()) 之後呼叫，表中的優先權為最終設定
+ */
+#define _INTERRUPT_SETUP(name, handler, priority) _INTERRUPT_SETUP_##name(priority);
+#define interruptDispatchBegin()    \
+    enableInterruptPriorityMode(1); \
+    INTERRUPT_TABLE(_INTERRUPT_SETUP)
+
+/* 快照: 每個暫存器讀取一次 (INTCON 類先存入區域變數，旗標與致能位元在同一暫存器)，只保留已致能且已註冊在此優先權的旗標 */
+#define _interruptSnapshot(level)                                                                     \
+    byte _intcon = _interruptMask(level, INTCON) ? INTCON : 0;                                        \
+    byte _intcon3 = _interruptMask(level, INTCON3) ? INTCON3 : 0;                                     \
+    _intcon = (byte)(_intcon & (_intcon >> 3) & _interruptMask(level, INTCON));                       \
+    _intcon3 = (byte)(_intcon3 & (_intcon3 >> 3) & _interruptMask(level, INTCON3));                   \
+    byte _pir1 = _interruptMask(level, PIR1) ? (byte)(PIR1 & PIE1 & _interruptMask(level, PIR1)) : 0; \
+    byte _pir2 = _interruptMask(level, PIR2) ? (byte)(PIR2 & PIE2 & _interruptMask(level, PIR2)) : 0
+
+#define _interruptFlags(reg) ((reg) == _INTERRUPT_INTCON ? _intcon : (reg) == _INTERRUPT_INTCON3 ? _intcon3 : (reg) == _INTERRUPT_PIR1 ? _pir1 : _pir2)
+
+/* 每列展開為一次位元測試；優先權不符的列為常數 0，由編譯器移除 */
+#define _INTERRUPT_CALL_HIGH(name, handler, priority)                                                     \
+    if ((priority) == INTERRUPT_HIGH && (_interruptFlags(_INTERRUPT_REG_##name) & _INTERRUPT_BIT_##name)) \
+        PROFILE_CALL(_INTERRUPT_ID_##name, handler());
+#define _INTERRUPT_CALL_LOW(name, handler, priority)                                                     \
+    if ((priority) == INTERRUPT_LOW && (_interruptFlags(_INTERRUPT_REG_##name) & _INTERRUPT_BIT_##name)) \
+        PROFILE_CALL(_INTERRUPT_ID_##name, handler());
+
+/**
+ * INTERRUPT_DISPATCH() - 產生高/低優先權 ISR
+ *
+ * 放在所有處理函式定義之後；程式中不可再另外定義 __interrupt 函式
+ */
+#define INTERRUPT_DISPATCH()                               \
+    void __interrupt(high_priority) _interruptHigh(void) { \
+        _interruptSnapshot(HIGH);                          \
+        INTERRUPT_TABLE(_INTERRUPT_CALL_HIGH)              \
+    }                                                      \
+    void __interrupt(low_priority) _interruptLow(void) {   \
+        _interruptSnapshot(LOW);                           \
+        INTERRUPT_TABLE(_INTERRUPT_CALL_LOW)               \
+    }
+#endif
+#pragma endregion InterruptDispatch
+
+/* ========== 中斷執行時間分析 / ISR Profiler ========== */
+#pragma region IsrProfile
+/**
+ * 以自由執行計時器量測每個中斷來源的執行週期
+ *
+ * - 在 #include "lib.h" 之前定義 ISR_PROFILE 才會啟用，否則所有巨集展開為空
+ * - 計時器以 1:1 計數指令週期，單次量測上限 65535 週期
+ * - 每個欄位記錄次數、總週期、最小與最大週期；欄位 0-14 對應 INTERRUPT_TABLE 的來源
+ *   (INT0 INT1 INT2 RB TMR0 TMR1 TMR2 TMR3 AD RC TX CCP1 CCP2 EE BCL)，由 INTERRUPT_DISPATCH() 自動量測
+ * - 手寫 ISR 或其他程式段可用 PROFILE_BEGIN(slot) / PROFILE_END(slot) 或 PROFILE_CALL(slot, stmt)
+ * - 低優先權來源的時間包含被高優先權中斷搶佔的時間
+ *
+ * 資源: PROFILE_TIMER 3 (預設) 時 Timer3 必須自由執行，不可與 addTimer3InterruptPeriod() 週期重載
+ *       或改變預分頻共用 (可與 Capture 共用，但 Capture 的預分頻器需維持 1:1)；
+ *       PROFILE_TIMER 0 時 Timer0 設為 16 位元 1:1
+ */
+#ifdef ISR_PROFILE
+
+#ifndef PROFILE_TIMER
+#define PROFILE_TIMER 3  // 時基: 0 = Timer0, 3 = Timer3
+#endif
+
+#ifndef PROFILE_SLOTS
+#define PROFILE_SLOTS 15  // 統計欄位數，15 以上的欄位供 PROFILE_BEGIN/END 自訂使用
+#endif
+
+#if PROFILE_SLOTS < 1 || PROFILE_SLOTS > 32
+#error "PROFILE_SLOTS 必須在 1 到 32 之間"
+#endif
+
+#if PROFILE_TIMER == 3
+#define _profileNow() TMR3  // RD16: 讀取 TMR3L 同時鎖存 TMR3H
+#define _profileTimerBegin() \
+    T3CONbits.RD16 = 1;      \
+    T3CONbits.TMR3CS = 0;    \
+    enableTimer3(TIMER3_PRESCALE_1)
+#elif PROFILE_TIMER == 0
+#define _profileNow() TMR0  // 16 位元模式: 讀取 TMR0L 同時鎖存 TMR0H
+#define _profileTimerBegin() \
+    enableTimer0(TIMER0_PRESCALE_2, TIMER0_PRESCALE_DISABLE, TIMER0_CLOCK_SOURCE_INTERNAL, TIMER0_MODE_16BIT)
+#else
+#error "PROFILE_TIMER 必須為 0 或 3"
+#endif
+
+typedef struct {
+    uint16_t count;  // 次數 (飽和於 65535)
+    uint32_t total;  // 總週期
+    uint16_t min;    // 最短週期
+    uint16_t max;    // 最長週期
+} ProfileStats;
+
+ProfileStats profileStats[PROFILE_SLOTS];
+
+/**
+ * _profileRecord() - 將一次量測累加到統計欄位
+ * @param slot   欄位
+ * @param start  進入時的計時器值
+ */
+void _profileRecord(byte slot, uint16_t start) {
+    uint16_t cycles = (uint16_t)(_profileNow() - start);
+    ProfileStats *stats = &profileStats[slot];
+    if (stats->count != 0xFFFF) {
+        stats->count++;
+        stats->total += cycles;
+    }
+    if (cycles < stats->min)
+        stats->min = cycles;
+    if (cycles > stats->max)
+        stats->max = cycles;
+}
+
+#define PROFILE_BEGIN(slot) uint16_t _profileStart##slot = _profileNow()  // 開始量測 (與 PROFILE_END 在同一區塊內成對使用)
+#define PROFILE_END(slot) _profileRecord(slot, _profileStart##slot)       // 結束量測並記錄
+
+/**
+ * PROFILE_CALL() - 量測一個敘述
+ * @param slot  欄位
+ * @param stmt  敘述 (如 handler())
+ */
+#define PROFILE_CALL(slot, stmt)                \
+    {                                           \
+        uint16_t _profileStart = _profileNow(); \
+        stmt;                                   \
+        _profileRecord(slot, _profileStart);    \
+    }
+
+/**
+ * profileReset() - 清除所有統計
+ */
+void profileReset(void) {
+    byte gie = INTCONbits.GIE;
+    INTCONbits.GIE = 0b0;
+    for (byte i = 0; i < PROFILE_SLOTS; i++) {
+        profileStats[i].count = 0;
+        profileStats[i].total = 0;
+        profileStats[i].min = 0xFFFF;
+        profileStats[i].max = 0;
+    }
+    INTCONbits.GIE = gie;
+}
+
+/**
+ * profileBegin() - 清除統計並啟動時基
+ */
+#define profileBegin() \
+    profileReset();    \
+    _profileTimerBegin()
+
+const char profileNames[15][5] = {"INT0", "INT1", "INT2", "RB", "TMR0", "TMR1", "TMR2", "TMR3",
+                                  "AD", "RC", "TX", "CCP1", "CCP2", "EE", "BCL"};
+
+/**
+ * profileDump() - 以 printf 輸出有資料的欄位 (來源 次數 總週期 最小 最大 平均)
+ *
+ * 每個欄位在關中斷下複製後才輸出，不會讀到更新一半的資料
+ */
+void profileDump(void) {
+    printf("ISR   count      total   min   max   avg\n");
+    for (byte i = 0; i < PROFILE_SLOTS; i++) {
+        byte gie = INTCONbits.GIE;
+        INTCONbits.GIE = 0b0;
+        ProfileStats stats = profileStats[i];
+        INTCONbits.GIE = gie;
+        if (!stats.count)
+            continue;
+        if (i < 15)
+            printf("%-4s", profileNames[i]);
+        else
+            printf("#%-3u", i);
+        printf(" %6u %10lu %5u %5u %5u\n", stats.count, (unsigned long)stats.total, stats.min, stats.max,
+               (uint16_t)(stats.total / stats.count));
+    }
+}
+
+#else
+#define PROFILE_BEGIN(slot)
+#define PROFILE_END(slot)
+#define PROFILE_CALL(slot, stmt) stmt
+#define profileReset()
+#define profileBegin()
+#define profileDump()
+#endif
+#pragma endregion IsrProfile
+
+/* ========== 臨界區段與原子存取 / Critical Section & Atomic Access ========== */
+#pragma region Atomic
+/**
+ * 8 位元核心上多位元組變數的讀寫需要多道指令，中斷若發生在中間會讀到半新半舊的值
+ *
+ * - CRITICAL_ENTER/EXIT: 暫停所有中斷 (清除 GIEH)，離開時分別還原 GIEH 與 GIEL
+ * - CRITICAL_LOW_ENTER/EXIT: 只暫停低優先權中斷 (清除 GIEL)，高優先權中斷維持致能；
+ *   資料只與低優先權 ISR 共用時使用
+ * - atomicLoad16/32: 不關中斷，連續讀取兩次直到相同，適合主迴圈讀取 ISR 更新的值
+ * - atomicStore16/32、atomicAdd16/32: 關閉所有中斷數個指令週期完成寫入
+ * - SeqLock: 大型結構由單一寫入者 (ISR) 更新，讀取者複製後檢查序號，不需關中斷
+ *
+ * 在高優先權 ISR 內存取不需保護 (不會被搶佔)
+ */
+
+/**
+ * CRITICAL_ENTER() - 進入臨界區段 (暫停所有中斷)
+ *
+ * 與 CRITICAL_EXIT() 在同一區塊內成對使用；巢狀使用時內層需放在獨立的 { } 區塊
+ */
+#define CRITICAL_ENTER()                               \
+    byte _criticalSaved = (byte)(INTCON & 0b11000000); \
+    INTCONbits.GIEH = 0b0
+#define CRITICAL_EXIT() INTCON |= _criticalSaved  // 離開臨界區段，還原 GIEH / GIEL
+
+/**
+ * CRITICAL_LOW_ENTER() - 進入低優先權臨界區段 (高優先權中斷維持致能)
+ */
+#define CRITICAL_LOW_ENTER()                  \
+    byte _criticalLowSaved = INTCONbits.GIEL; \
+    INTCONbits.GIEL = 0b0
+#define CRITICAL_LOW_EXIT() INTCONbits.GIEL = _criticalLowSaved  // 離開低優先權臨界區段
+
+/**
+ * atomicLoad16() - 不關中斷讀取 16 位元共用變數
+ * @param value  變數位址
+ * @return 某一時刻的完整值
+ */
+uint16_t atomicLoad16(volatile uint16_t *value) {
+    uint16_t first, second;
+    do {
+        first = *value;
+        second = *value;
+    } while (first != second);
+    return first;
+}
+
+/**
+ * atomicLoad32() - 不關中斷讀取 32 位元共用變數
+ * @param value  變數位址
+ * @return 某一時刻的完整值
+ */
+uint32_t atomicLoad32(volatile uint32_t *value) {
+    uint32_t first, second;
+    do {
+        first = *value;
+        second = *value;
+    } while (first != second);
+    return first;
+}
+
+/**
+ * atomicStore16() - 寫入 16 位元共用變數
+ * @param value     變數位址
+ * @param newValue  新值
+ */
+void atomicStore16(volatile uint16_t *value, uint16_t newValue) {
+    CRITICAL_ENTER();
+    *value = newValue;
+    CRITICAL_EXIT();
+}
+
+/**
+ * atomicStore32() - 寫入 32 位元共用變數
+ * @param value     變數位址
+ * @param newValue  新值
+ */
+void atomicStore32(volatile uint32_t *value, uint32_t newValue) {
+    CRITICAL_ENTER();
+    *value = newValue;
+    CRITICAL_EXIT();
+}
+
+/**
+ * atomicAdd16() - 對 16 位元共用變數加上數值
+ * @param value  變數位址
+ * @param delta  增量
+ * @return 相加後的值
+ */
+uint16_t atomicAdd16(volatile uint16_t *value, uint16_t delta) {
+    CRITICAL_ENTER();
+    uint16_t result = *value += delta;
+    CRITICAL_EXIT();
+    return result;
+}
+
+/**
+ * atomicAdd32() - 對 32 位元共用變數加上數值
+ * @param value  變數位址
+ * @param delta  增量
+ * @return 相加後的值
+ */
+uint32_t atomicAdd32(volatile uint32_t *value, uint32_t delta) {
+    CRITICAL_ENTER();
+    uint32_t result = *value += delta;
+    CRITICAL_EXIT();
+    return result;
+}
+
+#define atomicIncrement16(value) atomicAdd16(value, 1)  // 16 位元共用變數加 1
+#define atomicIncrement32(value) atomicAdd32(value, 1)  // 32 位元共用變數加 1
+
+/**
+ * SeqLock - 單一寫入者的序號鎖
+ *
+ * 寫入者 (ISR):
+ *   seqLockWriteBegin(lock);  ... 更新結構 ...  seqLockWriteEnd(lock);
+ * 讀取者 (主迴圈或較低優先權):
+ *   byte seq;
+ *   do {
+ *       seq = seqLockReadBegin(lock);
+ *       copy = shared;
+ *   } while (seqLockReadRetry(lock, seq));
+ *
+ * 寫入期間序號為奇數；讀取期間序號改變或為奇數即重新複製
+ * 寫入者的優先權必須高於讀取者 (讀取者不會在寫入途中執行)，否則讀取者會無限重試
+ */
+typedef struct {
+    volatile byte sequence;
+} SeqLock;
+
+#define seqLockWriteBegin(lock) (lock).sequence++                                // 開始寫入 (序號變為奇數)
+#define seqLockWriteEnd(lock) (lock).sequence++                                  // 結束寫入 (序號變為偶數)
+#define seqLockReadBegin(lock) ((lock).sequence)                                 // 取得讀取前的序號
+#define seqLockReadRetry(lock, seq) (((seq) & 0b1) || (lock).sequence != (seq))  // 是否需要重新讀取
+#pragma endregion Atomic
+
+/* ========== 單一生產者/消費者佇列 / SPSC Queue ========== */
+#pragma region Queue
+/**
+ * 產生固定容量的環形佇列，用於 ISR (生產者) 將事件交給主迴圈 (消費者)
+ *
+ * QUEUE_DEFINE(name, type, size) 產生變數 name 與下列函式:
+ *   bool name##Push(type value)             - 生產者放入；佇列已滿時丟棄並計數，回傳 false
+ *   bool name##Pop(type *value)             - 消費者取出一筆，佇列為空時回傳 false
+ *   byte name##PopBatch(type *values, max)  - 消費者一次取出最多 max 筆，回傳筆數
+ *   byte name##Count()                      - 目前筆數
+ *   byte name##Dropped()                    - 因佇列已滿而丟棄的筆數 (飽和於 255)
+ *   byte name##HighWater()                  - 曾經到達的最大筆數，用於調整容量
+ *
+ * - 容量必須為 2 的冪次且不超過 128；head 只由生產者寫入，tail 只由消費者寫入，
+ *   各為單一位元組，8 位元核心上讀寫不會被中斷切開，因此不需關閉中斷
+ * - 只能有一個生產者與一個消費者；兩個不同優先權的 ISR 需各自使用一個佇列
+ * - 生產者先寫入資料再更新 head，消費者先讀取資料再更新 tail
+ */
+#define QUEUE_DEFINE(name, type, size)                                                      \
+    typedef char name##SizeCheck[(((size) & ((size) - 1)) == 0 && (size) <= 128) ? 1 : -1]; \
+    struct {                                                                                \
+        volatile type buffer[size];                                                         \
+        volatile byte head;      /* 生產者索引 */                                           \
+        volatile byte tail;      /* 消費者索引 */                                           \
+        volatile byte dropped;   /* 丟棄筆數 (生產者寫入) */                                \
+        volatile byte highWater; /* 最大筆數 (生產者寫入) */                                \
+    } name;                                                                                 \
+                                                                                            \
+    bool name##Push(type value) {                                                           \
+        byte head = name.head;                                                              \
+        byte count = (byte)(head - name.tail);                                              \
+        if (count >= (size)) {                                                              \
+            if (name.dropped != 0xFF)                                                       \
+                name.dropped++;                                                             \
+            return false;                                                                   \
+        }                                                                                   \
+        name.buffer[head & ((size) - 1)] = value;                                           \
+        name.head = (byte)(head + 1);                                                       \
+        if (++count > name.highWater)                                                       \
+            name.highWater = count;                                                         \
+        return true;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    bool name##Pop(type *value) {                                                           \
+        byte tail = name.tail;                                                              \
+        if (tail == name.head)                                                              \
+            return false;                                                                   \
+        *value = name.buffer[tail & ((size) - 1)];                                          \
+        name.tail = (byte)(tail + 1);                                                       \
+        return true;                                                                        \
+    }                                                                                       \
+                                                                                            \
+    byte name##PopBatch(type *values, byte max) {                                           \
+        byte tail = name.tail;                                                              \
+        byte count = (byte)(name.head - tail);                                              \
+        if (count > max)                                                                    \
+            count = max;                                                                    \
+        for (byte i = 0; i < count; i++)                                                    \
+            values[i] = name.buffer[(byte)(tail + i) & ((size) - 1)];                       \
+        name.tail = (byte)(tail + count);                                                   \
+        return count;                                                                       \
+    }                                                                                       \
+                                                                                            \
+    byte name##Count(void) {                                                                \
+        return (byte)(name.head - name.tail);                                               \
+    }                                                                                       \
+                                                                                            \
+    byte name##Dropped(void) {                                                              \
+        return name.dropped;                                                                \
+    }                                                                                       \
+                                                                                            \
+    byte name##HighWater(void) {                                                            \
+        return name.highWater;                                                              \
+    }
+#pragma endregion Queue
+
+/* ========== 階層式狀態機 / Hierarchical State Machine ========== */
+#pragma region StateMachine
+/**
+ * 以程式記憶體中的常數表定義狀態、轉換與進入/離開動作
+ *
+ * - 狀態編號 1-254，0 (STATE_NONE) 保留；狀態表以狀態編號為索引 (建議使用 [STATE_X] = {...} 指定初始化)
+ * - 每個狀態的轉換表以事件編號為索引，共 eventCount 項；目標為 STATE_NONE 的事件交給父狀態處理
+ * - 分派為查表: 由目前狀態往父狀態逐層查詢，成本只與階層深度有關
+ * - 外部轉換依序執行: 離開動作 (由內而外) → 轉換動作 → 進入動作 (由外而內) → 初始子狀態
+ * - 目標為 STATE_INTERNAL 時只執行轉換動作，不離開目前狀態
+ * - 每個狀態可帶一個 value (如速度倍率、步進量)，供動作函式以 stateMachineValue() 讀取
+ *
+ * 同一個狀態機只能在一個執行環境 (同一個 ISR 或主迴圈) 中分派事件
+ */
+
+#define STATE_NONE 0         // 無父狀態 / 無初始子狀態 / 事件未處理
+#define STATE_INTERNAL 0xFF  // 內部轉換: 執行動作但不離開目前狀態
+
+#ifndef STATE_MACHINE_MAX_DEPTH
+#define STATE_MACHINE_MAX_DEPTH 4  // 最大階層深度
+#endif
+
+typedef struct {
+    byte target;                             // 目標狀態、STATE_INTERNAL 或 STATE_NONE (交給父狀態)
+    void (*action)(byte source, byte target); // 轉換動作 (可為 NULL)，source 為收到事件時的狀態
+} StateTransition;
+
+typedef struct {
+    byte parent;                         // 父狀態 (STATE_NONE 為最上層)
+    byte initial;                        // 進入後自動進入的子狀態 (STATE_NONE 為葉狀態)
+    byte value;                          // 使用者資料
+    void (*entry)(byte state);           // 進入動作 (可為 NULL)
+    void (*exit)(byte state);            // 離開動作 (可為 NULL)
+    const StateTransition *transitions;  // 轉換表 [eventCount] (可為 NULL)
+} StateDefinition;
+
+typedef struct {
+    const StateDefinition *states;  // 狀態表
+    byte eventCount;                // 事件數
+    volatile byte current;          // 目前 (最內層) 狀態
+} StateMachine;
+
+#define stateMachineState(machine) (machine).current                                      // 目前狀態
+#define stateMachineValue(machine, state) (machine).states[state].value                   // 狀態的 value
+#define stateMachineIsIn(machine, state) _stateIsIn((machine).states, state, (machine).current)  // 是否位於 state 或其子狀態
+
+/**
+ * _stateIsIn() - state 是否為 ancestor 本身或其子孫
+ */
+bool _stateIsIn(const StateDefinition *states, byte ancestor, byte state) {
+    for (byte depth = 0; state != STATE_NONE && depth < STATE_MACHINE_MAX_DEPTH; depth++) {
+        if (state == ancestor)
+            return true;
+        state = states[state].parent;
+    }
+    return false;
+}
+
+/**
+ * _stateEnter() - 由 from 的下一層進入到 target，再依初始子狀態往下進入
+ */
+void _stateEnter(StateMachine *machine, byte from, byte target) {
+    const StateDefinition *states = machine->states;
+    byte path[STATE_MACHINE_MAX_DEPTH];
+    byte depth = 0;
+    for (byte state = target; state != from && state != STATE_NONE && depth < STATE_MACHINE_MAX_DEPTH; state = states[state].parent)
+        path[depth++] = state;
+    while (depth) {
+        byte state = path[--depth];
+        machine->current = state;
+        if (states[state].entry)
+            states[state].entry(state);
+    }
+    for (byte state; (state = states[machine->current].initial) != STATE_NONE;) {
+        machine->current = state;
+        if (states[state].entry)
+            states[state].entry(state);
+    }
+}
+
+/**
+ * stateMachineBegin() - 初始化狀態機並進入初始狀態 (執行進入動作)
+ * @param machine     狀態機
+ * @param states      狀態表 (索引 0 不使用)
+ * @param eventCount  事件數 (每個轉換表的項數)
+ * @param initial     初始狀態
+ */
+void stateMachineBegin(StateMachine *machine, const StateDefinition *states, byte eventCount, byte initial) {
+    machine->states = states;
+    machine->eventCount = eventCount;
+    machine->current = STATE_NONE;
+    _stateEnter(machine, STATE_NONE, initial);
+}
+
+/**
+ * stateMachineDispatch() - 分派一個事件
+ * @param machine  狀態機
+ * @param event    事件編號 (0 ~ eventCount-1)
+ * @return 事件是否被處理
+ */
+bool stateMachineDispatch(StateMachine *machine, byte event) {
+    if (event >= machine->eventCount)
+        return false;
+    const StateDefinition *states = machine->states;
+    byte source = machine->current;
+
+    const StateTransition *transition = NULL;
+    byte handler = source;
+    for (byte depth = 0; handler != STATE_NONE && depth < STATE_MACHINE_MAX_DEPTH; depth++) {
+        const StateTransition *table = states[handler].transitions;
+        if (table && table[event].target != STATE_NONE) {
+            transition = &table[event];
+            break;
+        }
+        handler = states[handler].parent;
+    }
+    if (!transition)
+        return false;
+
+    byte target = transition->target;
+    if (target == STATE_INTERNAL) {
+        if (transition->action)
+            transition->action(source, source);
+        return true;
+    }
+
+    // 共同祖先: 目標的父狀態中，最內層且包含目前狀態者 (自我轉換會離開並重新進入)
+    byte common = states[target].parent;
+    while (common != STATE_NONE && !_stateIsIn(states, common, source))
+        common = states[common].parent;
+
+    while (machine->current != common && machine->current != STATE_NONE) {
+        byte state = machine->current;
+        if (states[state].exit)
+            states[state].exit(state);
+        machine->current = states[state].parent;
+    }
+    if (transition->action)
+        transition->action(source, target);
+    _stateEnter(machine, common, target);
+    return true;
+}
+#pragma endregion StateMachine
+
+/* ========== 功能路由 / Feature Routing ========== */
+#pragma region Routing
+/**
+ * 將輸入 (ADC、按鈕、UART 數字等) 綁定到輸出功能，綁定可在執行期增減
+ *
+ * - 路由表 (RouteDefinition) 為 const 資料: 名稱、輸入編號、佔用的資源位元、處理函式、啟動/停止動作
+ * - 輸入編號與資源位元由應用程式定義；資源為腳位或周邊 (如 RC1/CCP2、RD0-RD3)，
+ *   也可用一個位元代表只能有一個使用者的輸入
+ * - routeBind() 在綁定時檢查資源，已被其他綁定佔用時回傳 ROUTE_CONFLICT 而不綁定
+ * - routeDispatch() 只走訪目前的綁定 (最多 ROUTE_MAX_BINDINGS 個)，未綁定的功能不花任何時間
+ *
+ * routeBind() / routeUnbind() 可在主迴圈或低優先權 ISR 呼叫；綁定串列以臨界區段更新，
+ * 啟動動作在加入串列前執行，停止動作在移出串列後執行
+ */
+
+#ifndef ROUTE_MAX_BINDINGS
+#define ROUTE_MAX_BINDINGS 4  // 同時存在的綁定數上限
+#endif
+
+#define ROUTE_NONE 0xFF  // 無路由
+
+/* routeBind() 回傳值 */
+#define ROUTE_OK 0        // 已綁定
+#define ROUTE_INVALID 1   // 路由編號不存在
+#define ROUTE_CONFLICT 2  // 資源已被其他綁定佔用 (以 routeConflict() 查詢)
+#define ROUTE_FULL 3      // 綁定數已達 ROUTE_MAX_BINDINGS
+
+typedef struct {
+    const char *name;                 // 名稱 (routeList() 輸出)
+    byte input;                       // 輸入編號
+    byte resources;                   // 佔用的資源位元
+    void (*handler)(uint16_t value);  // 輸入處理函式
+    void (*start)(void);              // 綁定時執行 (可為 NULL)
+    void (*stop)(void);               // 解除綁定時執行 (可為 NULL)
+} RouteDefinition;
+
+const RouteDefinition *routeTable;       // 路由表
+byte routeCount;                         // 路由數
+byte routeBindings[ROUTE_MAX_BINDINGS];  // 目前的綁定 (路由編號)
+volatile byte routeBindingCount;         // 綁定數
+byte routeClaimed;                       // 已佔用的資源位元
+
+/**
+ * routeBegin() - 設定路由表並清除所有綁定
+ * @param table  路由表
+ * @param count  路由數
+ */
+void routeBegin(const RouteDefinition *table, byte count) {
+    routeBindingCount = 0;
+    routeClaimed = 0;
+    routeTable = table;
+    routeCount = count;
+}
+
+/**
+ * routeIsBound() - 路由是否已綁定
+ * @param route  路由編號
+ */
+bool routeIsBound(byte route) {
+    for (byte i = 0; i < routeBindingCount; i++)
+        if (routeBindings[i] == route)
+            return true;
+    return false;
+}
+
+/**
+ * routeConflict() - 查詢與路由資源重疊的已綁定路由
+ * @param route  路由編號
+ * @return 佔用資源的路由編號，沒有衝突時回傳 ROUTE_NONE
+ */
+byte routeConflict(byte route) {
+    byte resources = routeTable[route].resources;
+    for (byte i = 0; i < routeBindingCount; i++) {
+        byte bound = routeBindings[i];
+        if (bound != route && (routeTable[bound].resources & resources))
+            return bound;
+    }
+    return ROUTE_NONE;
+}
+
+/**
+ * routeBind() - 綁定路由
+ * @param route  路由編號
+ * @return ROUTE_OK、ROUTE_INVALID、ROUTE_CONFLICT 或 ROUTE_FULL
+ */
+byte routeBind(byte route) {
+    if (route >= routeCount)
+        return ROUTE_INVALID;
+    if (routeIsBound(route))
+        return ROUTE_OK;
+    if (routeClaimed & routeTable[route].resources)
+        return ROUTE_CONFLICT;
+    if (routeBindingCount >= ROUTE_MAX_BINDINGS)
+        return ROUTE_FULL;
+
+    if (routeTable[route].start)
+        routeTable[route].start();
+    CRITICAL_ENTER();
+    routeBindings[routeBindingCount] = route;
+    routeBindingCount++;
+    routeClaimed |= routeTable[route].resources;
+    CRITICAL_EXIT();
+    return ROUTE_OK;
+}
+
+/**
+ * routeUnbind() - 解除綁定並釋放資源
+ * @param route  路由編號
+ * @return 是否曾經綁定
+ */
+bool routeUnbind(byte route) {
+    bool found = false;
+    CRITICAL_ENTER();
+    for (byte i = 0; i < routeBindingCount; i++) {
+        if (routeBindings[i] == route)
+            found = true;
+        else if (found)
+            routeBindings[i - 1] = routeBindings[i];
+    }
+    if (found) {
+        routeBindingCount--;
+        routeClaimed &= (byte)~routeTable[route].resources;
+    }
+    CRITICAL_EXIT();
+    if (found && routeTable[route].stop)
+        routeTable[route].stop();
+    return found;
+}
+
+/**
+ * routeDispatch() - 將輸入值交給所有綁定到該輸入的路由
+ * @param input  輸入編號
+ * @param value  輸入值
+ */
+void routeDispatch(byte input, uint16_t value) {
+    for (byte i = 0; i < routeBindingCount; i++) {
+        const RouteDefinition *route = &routeTable[routeBindings[i]];
+        if (route->input == input)
+            route->handler(value);
+    }
+}
+
+/**
+ * routeList() - 以 printf 列出所有路由與綁定狀態
+ */
+void routeList(void) {
+    for (byte i = 0; i < routeCount; i++)
+        printf("%c%2u %s\n", routeIsBound(i) ? '*' : ' ', i, routeTable[i].name);
+}
+#pragma endregion Routing
+
+/* ========== 兩層搶佔式核心 / Run-to-Completion Kernel ========== */
+#pragma region Kernel
+/**
+ * 以兩個中斷優先權實現搶佔的 run-to-completion 核心，所有工作共用硬體堆疊
+ *
+ * - 三個層級: KERNEL_HIGH (高優先權中斷)、KERNEL_MEDIUM (低優先權中斷)、KERNEL_BACKGROUND (主迴圈)
+ * - 工作為 void task(byte event)，每次執行到結束，不可等待；較高層級的工作隨時搶佔較低層級，
+ *   同一層級依投遞順序執行
+ * - 每個層級有自己的事件佇列 (KERNEL_QUEUE_SIZE 筆)，kernelPost() 可在任何執行環境呼叫，
+ *   佇列已滿時丟棄並計數
+ * - HIGH / MEDIUM 以軟體設定中斷旗標觸發，需在 INTERRUPT_TABLE 註冊:
+ *     X(BCL, kernelRunHigh, INTERRUPT_HIGH)
+ *     X(EE, kernelRunMedium, INTERRUPT_LOW)
+ *   只使用其中一層時可只註冊該層；KERNEL_HIGH_FLAG / KERNEL_MEDIUM_FLAG 可改為其他未使用的中斷旗標
+ * - BACKGROUND 由主迴圈呼叫 kernelRunBackground() 執行
+ *
+ * 資源: 預設使用 EEIF (EEPROM 寫入完成) 與 BCLIF (MSSP 匯流排碰撞)，不可再使用 EEPROM 寫入中斷或 I2C 主控；
+ *       每個工作只投遞到同一個層級 (XC8 不支援同一函式在不同中斷環境中重入)
+ */
+
+#ifndef KERNEL_QUEUE_SIZE
+#define KERNEL_QUEUE_SIZE 8  // 每個層級的事件佇列容量 (2 的冪次，不超過 128)
+#endif
+
+#if (KERNEL_QUEUE_SIZE & (KERNEL_QUEUE_SIZE - 1)) || KERNEL_QUEUE_SIZE > 128
+#error "KERNEL_QUEUE_SIZE 必須為 2 的冪次且不超過 128"
+#endif
+
+#ifndef KERNEL_HIGH_FLAG
+#define KERNEL_HIGH_FLAG PIR2bits.BCLIF  // 觸發高優先權層級的中斷旗標
+#endif
+#ifndef KERNEL_MEDIUM_FLAG
+#define KERNEL_MEDIUM_FLAG PIR2bits.EEIF  // 觸發低優先權層級的中斷旗標
+#endif
+
+#define KERNEL_HIGH 0        // 高優先權中斷環境
+#define KERNEL_MEDIUM 1      // 低優先權中斷環境
+#define KERNEL_BACKGROUND 2  // 主迴圈
+#define KERNEL_LEVELS 3
+
+typedef struct {
+    void (*task)(byte event);  // 工作
+    byte event;                // 事件參數
+} KernelEvent;
+
+typedef struct {
+    KernelEvent buffer[KERNEL_QUEUE_SIZE];
+    volatile byte head;       // 投遞索引 (臨界區段內寫入)
+    volatile byte tail;       // 執行索引 (只由該層級寫入)
+    volatile byte dropped;    // 丟棄筆數 (飽和於 255)
+    volatile byte highWater;  // 最大筆數
+} KernelQueue;
+
+KernelQueue kernelQueues[KERNEL_LEVELS];
+
+#define kernelDropped(level) kernelQueues[level].dropped      // 層級因佇列已滿而丟棄的筆數
+#define kernelHighWater(level) kernelQueues[level].highWater  // 層級佇列曾經到達的最大筆數
+
+/**
+ * kernelPost() - 投遞事件給工作
+ * @param level  KERNEL_HIGH、KERNEL_MEDIUM 或 KERNEL_BACKGROUND
+ * @param task   工作
+ * @param event  事件參數
+ * @return 佇列已滿時回傳 false
+ *
+ * 投遞到比目前環境高的層級時，離開臨界區段後立即被搶佔執行
+ */
+bool kernelPost(byte level, void (*task)(byte event), byte event) {
+    KernelQueue *queue = &kernelQueues[level];
+    bool posted = false;
+    CRITICAL_ENTER();
+    byte head = queue->head;
+    byte count = (byte)(head - queue->tail);
+    if (count < KERNEL_QUEUE_SIZE) {
+        queue->buffer[head & (KERNEL_QUEUE_SIZE - 1)].task = task;
+        queue->buffer[head & (KERNEL_QUEUE_SIZE - 1)].event = event;
+        queue->head = (byte)(head + 1);
+        if (++count > queue->highWater)
+            queue->highWater = count;
+        if (level == KERNEL_HIGH)
+            KERNEL_HIGH_FLAG = 0b1;
+        else if (level == KERNEL_MEDIUM)
+            KERNEL_MEDIUM_FLAG = 0b1;
+        posted = true;
+    } else if (queue->dropped != 0xFF) {
+        queue->dropped++;
+    }
+    CRITICAL_EXIT();
+    return posted;
+}
+
+/**
+ * _kernelRun() - 依序執行層級佇列中的事件直到清空
+ * @return 執行的筆數
+ *
+ * 先複製並釋放佇列位置再執行，工作可以再投遞到自己的層級
+ */
+byte _kernelRun(KernelQueue *queue) {
+    byte count = 0;
+    byte tail;
+    while ((tail = queue->tail) != queue->head) {
+        KernelEvent next = queue->buffer[tail & (KERNEL_QUEUE_SIZE - 1)];
+        queue->tail = (byte)(tail + 1);
+        next.task(next.event);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * kernelRunHigh() - 高優先權層級的中斷處理函式 (註冊於 INTERRUPT_TABLE)
+ */
+void kernelRunHigh(void) {
+    KERNEL_HIGH_FLAG = 0b0;
+    _kernelRun(&kernelQueues[KERNEL_HIGH]);
+}
+
+/**
+ * kernelRunMedium() - 低優先權層級的中斷處理函式 (註冊於 INTERRUPT_TABLE)
+ */
+void kernelRunMedium(void) {
+    KERNEL_MEDIUM_FLAG = 0b0;
+    _kernelRun(&kernelQueues[KERNEL_MEDIUM]);
+}
+
+/**
+ * kernelRunBackground() - 在主迴圈執行背景層級的所有事件
+ * @return 執行的筆數，0 表示閒置
+ */
+#define kernelRunBackground() _kernelRun(&kernelQueues[KERNEL_BACKGROUND])
+#pragma endregion Kernel
@@ -10,7 +10,7 @@
  * - PWM 脈寬調變輸出 (RC1/CCP2)
  * - ADC 類比數位轉換 (RA0/AN0)
  * - UART 串列通訊 (RC6/TX, RC7/RX)
- * - 外部按鈕中斷處理 (RB0)
+ * - 按鈕去彈跳 (RB0，Timer3 每 10ms 取樣)
  * - 計時器中斷處理 (Timer1, Timer2, Timer3)
  *
  * 【硬體接線圖】
@@ -42,6 +42,26 @@
 
 
 #define _XTAL_FREQ 4000000  // 內部時脈頻率 4MHz
+
+/*
+ * 中斷註冊表：同一優先權內依列出順序檢查
+ * 去彈跳最短放最前，ADC 處理最長放最後；UART 接收使用低優先權
+ * EE 為軟體觸發的核心中層（KERNEL_MEDIUM），按鈕工作在低優先權中執行，不延遲伺服馬達與 ADC
+ */
+#define INTERRUPT_TABLE(X)                 \
+  X(TMR3, onDebounceTick, INTERRUPT_HIGH)  \
+  X(TMR1, onLedTick, INTERRUPT_HIGH)       \
+  X(AD, onADConverter, INTERRUPT_HIGH)     \
+  X(RC, onSerialReceive, INTERRUPT_LOW)    \
+  X(EE, kernelRunMedium, INTERRUPT_LOW)
+#define INTERRUPT_REPORT_LATENCY  // 編譯時輸出估算的分派延遲
+
+/*
+ * 中斷執行週期分析（'p' 命令輸出）
+ * Timer3 由去彈跳週期重載，因此以 Timer0 作為自由執行時基；移除 ISR_PROFILE 即完全不產生程式碼
+ */
+#define ISR_PROFILE
+#define PROFILE_TIMER 0
 #include "lib.h"
 
 
@@ -61,31 +81,43 @@
 
 /*
  * ============================================================================
- * 功能啟用旗標（全域變數）
+ * 功能路由（輸入 → 功能）
  * ============================================================================
- * 這些布林變數用於控制各項功能的啟用/停用
+ * 每個功能是一條路由：輸入來源、佔用的資源、處理函式，路由表 routes[] 定義在 main() 之前
+ * 執行期以 UART 命令綁定或解除（b <編號>、u <編號>、l 列出），中斷只呼叫已綁定的功能
  *
- * 【注意】功能衝突說明：
- * - RD0-RD3 LED 功能互斥（同時只能啟用一個）
- * - RC1/CCP2 PWM 功能互斥：enableLedPwmADC, enableLedFlashADC
- * - UART 輸入功能互斥：enableSetServoAngleUart, enableUartToBinary
- */
-bool enableLedBinaryADC,              // ADC 值以二進位顯示在 LED (RD0-RD3)
-     enableServoADC,                  // ADC 值控制伺服馬達角度
-     enableLedPwmADC,                 // ADC 值控制 LED PWM 亮度 (RC1)
-     enableLedMarqueeADC,             // ADC 值控制 LED 跑馬燈-多顆 (RD0-RD3)
-     enableBinaryButtonCount,         // 按鈕計數以二進位顯示在 LED
-     enableServoTurnRangeSwitchButton,// 按鈕切換伺服馬達轉動範圍（5 種）
-     enableSetServoAngleUart,         // 透過 UART 設定伺服馬達角度
-     enableServoTurnAngleButton,      // 按鈕切換伺服馬達固定角度
-     enableLedFlashADC,               // ADC 值控制 LED 閃爍頻率（四段式）
-     enableLedMarqueeADC_Single,      // ADC 值控制單顆 LED 跑馬燈 (RD0-RD3)
-     enable10StateFromADC,            // ADC 映射 10 狀態，二進位顯示 0-9
-     enable7TodayStateFromADC,        // ADC 映射 7 狀態，顯示日期
-     enableEvenOddADC,                // ADC 遞增顯示奇數，遞減顯示偶數
-     enableSequentialLedButton,       // 按鈕切換 LED 跑馬燈速度（3 顆 LED）
-     enableSequentialLedButton_4,     // 按鈕切換 LED 跑馬燈速度（4 顆 LED）
-     enableUartToBinary;              // UART 輸入數字以二進位顯示在 LED
+ * 【注意】功能衝突說明（綁定時檢查，衝突時回報佔用者且不綁定）：
+ * - RD0-RD3 LED 功能互斥（同時只能綁定一個）
+ * - RC1/CCP2 PWM 功能互斥：LED PWM 亮度、LED 閃爍
+ * - RC2/CCP1 伺服馬達功能互斥
+ * - UART 輸入功能互斥：UART 設定伺服馬達角度、UART 二進位顯示
+ */
+enum { ROUTE_INPUT_ADC, ROUTE_INPUT_BUTTON, ROUTE_INPUT_UART };
+
+#define RESOURCE_SERVO 0b0001        // RC2/CCP1 伺服馬達
+#define RESOURCE_PWM_LED 0b0010      // RC1/CCP2 PWM LED
+#define RESOURCE_LEDS 0b0100         // RD0-RD3 LED
+#define RESOURCE_UART_NUMBER 0b1000  // UART 數字輸入（只能有一個使用者）
+
+enum {
+  ROUTE_LED_BINARY_ADC,          // ADC 值以二進位顯示在 LED (RD0-RD3)
+  ROUTE_SERVO_ADC,               // ADC 值控制伺服馬達角度
+  ROUTE_LED_PWM_ADC,             // ADC 值控制 LED PWM 亮度 (RC1)
+  ROUTE_LED_MARQUEE_ADC,         // ADC 值控制 LED 跑馬燈-多顆 (RD0-RD3)
+  ROUTE_BINARY_BUTTON_COUNT,     // 按鈕計數以二進位顯示在 LED
+  ROUTE_SERVO_RANGE_BUTTON,      // 按鈕切換伺服馬達轉動範圍（5 種）
+  ROUTE_SERVO_ANGLE_UART,        // 透過 UART 設定伺服馬達角度
+  ROUTE_SERVO_ANGLE_BUTTON,      // 按鈕切換伺服馬達固定角度
+  ROUTE_LED_FLASH_ADC,           // ADC 值控制 LED 閃爍頻率（四段式）
+  ROUTE_LED_MARQUEE_SINGLE_ADC,  // ADC 值控制單顆 LED 跑馬燈 (RD0-RD3)
+  ROUTE_10_STATE_ADC,            // ADC 映射 10 狀態，二進位顯示 0-9
+  ROUTE_7_TODAY_STATE_ADC,       // ADC 映射 7 狀態，顯示日期
+  ROUTE_EVEN_ODD_ADC,            // ADC 遞增顯示奇數，遞減顯示偶數
+  ROUTE_SEQUENTIAL_LED_BUTTON,   // 按鈕切換 LED 跑馬燈速度（3 顆 LED）
+  ROUTE_SEQUENTIAL_LED_BUTTON_4, // 按鈕切換 LED 跑馬燈速度（4 顆 LED）
+  ROUTE_UART_TO_BINARY,          // UART 輸入數字以二進位顯示在 LED
+  ROUTE_COUNT
+};
 
 
 /*
@@ -93,10 +125,12 @@ bool enableLedBinaryADC,              // ADC 值以二進位顯示在 LED (RD0-R
  * 狀態變數（全域變數）
  * ============================================================================
  */
-uint8_t servoTurnRangeState;   // 伺服馬達轉動範圍狀態（1-5）
-uint16_t buttonClickCount;     // 按鈕點擊計數器
-int currentServoAngle;         // 目前伺服馬達角度（0-180°）
-uint16_t servoAngleState;      // 伺服馬達角度狀態機（0, 1, 2）
+/*
+ * 以下兩個 16 位元變數只由按鈕工作（KERNEL_MEDIUM）與 UART 命令寫入
+ * 兩者都在低優先級中斷中執行，不會互相打斷，不需臨界區段
+ */
+volatile uint16_t buttonClickCount;   // 按鈕點擊計數器
+volatile uint16_t currentServoAngle;  // 目前伺服馬達角度（0-180°）
 
 
 /*
@@ -124,19 +158,6 @@ bool ledFlashState;            // LED 目前狀態（true=亮, false=滅）
 uint8_t ledFlashZone;          // 目前閃爍區域（1, 2, 3, 4）
 
 
-/*
- * ============================================================================
- * 按鈕控制 LED 跑馬燈功能狀態變數
- * ============================================================================
- * 3 顆 LED 版本 (RD0-RD2)：0.25s, 0.5s, 1.0s
- * 4 顆 LED 版本 (RD0-RD3)：0.25s, 0.5s, 0.75s, 1.0s
- */
-uint8_t seqLedSpeedState;      // 速度狀態（1, 2, 3 或 1, 2, 3, 4）
-uint8_t seqLedPosition;        // 目前 LED 位置（0-2 或 0-3）
-uint8_t seqLedCounter;         // 計時計數器（Timer1 中斷次數）
-uint8_t seqLedThreshold;       // 計時門檻值（達到此值時切換 LED）
-
-
 /*
  * ============================================================================
  * led4Bit - LED 4 位元顯示函式
@@ -155,12 +176,232 @@ uint8_t seqLedThreshold;       // 計時門檻值（達到此值時切換 LED）
  *   value = 5 (0b0101) → RD0=1, RD1=0, RD2=1, RD3=0
  *   value = 15 (0b1111) → 全亮
  *   value = 0 (0b0000) → 全滅
+ *
+ * 【實作】一次遮罩寫入 LATD，不影響 RD4-RD7，也不會有逐顆更新的中間狀態
  */
+#define LED_GROUP PIN_GROUP(D, 0, 4)  // RD0-RD3
+
 void led4Bit(byte value) {
-  digitalWrite(PIN_RD0, (value >> 0) & 0b1);  // 取出 bit 0 並輸出
-  digitalWrite(PIN_RD1, (value >> 1) & 0b1);  // 取出 bit 1 並輸出
-  digitalWrite(PIN_RD2, (value >> 2) & 0b1);  // 取出 bit 2 並輸出
-  digitalWrite(PIN_RD3, (value >> 3) & 0b1);  // 取出 bit 3 並輸出
+  digitalWriteGroup(LED_GROUP, value);  // LATD = (LATD & ~0x0F) | value，四顆 LED 同時更新
+}
+
+
+/*
+ * ============================================================================
+ * LED 動畫資料（程式記憶體）
+ * ============================================================================
+ * 所有 LED 圖樣皆為常數表，中斷中只選擇幀並做一次 LATD 寫入
+ *
+ * 時間驅動（Timer1 每 250ms 一個節拍，倍率由按鈕切換）：
+ *   chase3Animation：RD0 → RD1 → RD2 循環
+ *   chase4Animation：RD0 → RD1 → RD2 → RD3 循環
+ *
+ * ADC 選擇幀（animationShow）：
+ *   marqueeAnimation：多顆跑馬燈 9 個位置
+ *   singleAnimation ：單顆跑馬燈，左右兩端全滅
+ *   dateAnimation   ：日期 2025/12/03 的數字序列
+ */
+const byte chase3Frames[] = {0b0001, 0b0010, 0b0100};
+const byte chase4Frames[] = {0b0001, 0b0010, 0b0100, 0b1000};
+const byte marqueeFrames[] = {0b1111, 0b0111, 0b0011, 0b0001, 0b0000, 0b1000, 0b1100, 0b1110, 0b1111};
+const byte singleFrames[] = {0b0000, 0b0001, 0b0010, 0b0100, 0b1000, 0b0000};
+const byte dateFrames[] = {2, 0, 2, 5, 12, 0, 3};
+
+const LedAnimation chase3Animation = LED_ANIMATION(chase3Frames, 1, true);
+const LedAnimation chase4Animation = LED_ANIMATION(chase4Frames, 1, true);
+const LedAnimation marqueeAnimation = LED_ANIMATION(marqueeFrames, 1, false);
+const LedAnimation singleAnimation = LED_ANIMATION(singleFrames, 1, false);
+const LedAnimation dateAnimation = LED_ANIMATION(dateFrames, 1, false);
+
+AnimationPlayer ledPlayer;  // RD0-RD3 動畫播放器
+
+/* LED 功能解除綁定：停止動畫並熄滅 */
+void clearLeds(void) {
+  animationStop(&ledPlayer);
+  led4Bit(0);
+}
+
+
+/*
+ * ============================================================================
+ * 按鈕模式狀態機（程式記憶體轉換表）
+ * ============================================================================
+ * 事件：MODE_EVENT_PRESS（按鈕按下）、MODE_EVENT_RESET（'r' 命令）
+ * 各狀態機的最上層狀態處理 RESET，子狀態只處理 PRESS
+ * PRESS 由按鈕工作、RESET 由 UART 命令分派，兩者都在低優先級中斷中，每個事件只做查表
+ *
+ * 伺服馬達範圍：UPPER → FULL → LOWER → MIDDLE → SLEEP → UPPER（value 為顯示編號）
+ * 伺服馬達角度：每按一次依序增加 45° → 90° → 180°（value 為增量）
+ * LED 跑馬燈速度：3 顆 1 → 2 → 4 節拍、4 顆 1 → 2 → 3 → 4 節拍（value 為動畫倍率）
+ */
+enum { MODE_EVENT_PRESS, MODE_EVENT_RESET, MODE_EVENT_COUNT };
+
+enum {
+  RANGE_ROOT = 1,
+  RANGE_UPPER,   // 90° ↔ 180°
+  RANGE_FULL,    // 0° ↔ 180°
+  RANGE_LOWER,   // 0° ↔ 90°
+  RANGE_MIDDLE,  // 45° ↔ 135°
+  RANGE_SLEEP,   // 停止擺動，固定 90°
+  RANGE_STATES
+};
+
+enum { ANGLE_ROOT = 1, ANGLE_STEP_45, ANGLE_STEP_90, ANGLE_STEP_180, ANGLE_STATES };
+
+enum { SEQ_ROOT = 1, SEQ_SPEED_1, SEQ_SPEED_2, SEQ_SPEED_3, SEQ_SPEED_4, SEQ_STATES };
+
+StateMachine servoRangeMachine;
+StateMachine servoAngleMachine;
+StateMachine seqLedMachine;
+
+void printServoRange(byte source, byte target) {
+  printf("Servo Range State:%d\n", stateMachineValue(servoRangeMachine, target));
+}
+
+void turnServo(byte source, byte target) {
+  currentServoAngle = (currentServoAngle + stateMachineValue(servoAngleMachine, source)) % 180;
+  setCCP1ServoAngle(currentServoAngle, 16);
+}
+
+void setSeqLedSpeed(byte state) {
+  animationSetScale(ledPlayer, stateMachineValue(seqLedMachine, state));  // 下一步起生效
+}
+
+void printSeqLed(byte source, byte target);
+
+const StateTransition rangeTransitions[RANGE_STATES][MODE_EVENT_COUNT] = {
+  [RANGE_ROOT] = {[MODE_EVENT_RESET] = {RANGE_UPPER, NULL}},
+  [RANGE_UPPER] = {[MODE_EVENT_PRESS] = {RANGE_FULL, printServoRange}},
+  [RANGE_FULL] = {[MODE_EVENT_PRESS] = {RANGE_LOWER, printServoRange}},
+  [RANGE_LOWER] = {[MODE_EVENT_PRESS] = {RANGE_MIDDLE, printServoRange}},
+  [RANGE_MIDDLE] = {[MODE_EVENT_PRESS] = {RANGE_SLEEP, printServoRange}},
+  [RANGE_SLEEP] = {[MODE_EVENT_PRESS] = {RANGE_UPPER, printServoRange}},
+};
+const StateDefinition rangeStates[RANGE_STATES] = {
+  [RANGE_ROOT] = {STATE_NONE, RANGE_UPPER, 0, NULL, NULL, rangeTransitions[RANGE_ROOT]},
+  [RANGE_UPPER] = {RANGE_ROOT, STATE_NONE, 1, NULL, NULL, rangeTransitions[RANGE_UPPER]},
+  [RANGE_FULL] = {RANGE_ROOT, STATE_NONE, 2, NULL, NULL, rangeTransitions[RANGE_FULL]},
+  [RANGE_LOWER] = {RANGE_ROOT, STATE_NONE, 3, NULL, NULL, rangeTransitions[RANGE_LOWER]},
+  [RANGE_MIDDLE] = {RANGE_ROOT, STATE_NONE, 4, NULL, NULL, rangeTransitions[RANGE_MIDDLE]},
+  [RANGE_SLEEP] = {RANGE_ROOT, STATE_NONE, 5, NULL, NULL, rangeTransitions[RANGE_SLEEP]},
+};
+
+const StateTransition angleTransitions[ANGLE_STATES][MODE_EVENT_COUNT] = {
+  [ANGLE_ROOT] = {[MODE_EVENT_RESET] = {ANGLE_STEP_45, NULL}},
+  [ANGLE_STEP_45] = {[MODE_EVENT_PRESS] = {ANGLE_STEP_90, turnServo}},
+  [ANGLE_STEP_90] = {[MODE_EVENT_PRESS] = {ANGLE_STEP_180, turnServo}},
+  [ANGLE_STEP_180] = {[MODE_EVENT_PRESS] = {ANGLE_STEP_45, turnServo}},
+};
+const StateDefinition angleStates[ANGLE_STATES] = {
+  [ANGLE_ROOT] = {STATE_NONE, ANGLE_STEP_45, 0, NULL, NULL, angleTransitions[ANGLE_ROOT]},
+  [ANGLE_STEP_45] = {ANGLE_ROOT, STATE_NONE, 45, NULL, NULL, angleTransitions[ANGLE_STEP_45]},
+  [ANGLE_STEP_90] = {ANGLE_ROOT, STATE_NONE, 90, NULL, NULL, angleTransitions[ANGLE_STEP_90]},
+  [ANGLE_STEP_180] = {ANGLE_ROOT, STATE_NONE, 180, NULL, NULL, angleTransitions[ANGLE_STEP_180]},
+};
+
+const StateTransition seq3Transitions[SEQ_STATES][MODE_EVENT_COUNT] = {
+  [SEQ_ROOT] = {[MODE_EVENT_RESET] = {SEQ_SPEED_1, NULL}},
+  [SEQ_SPEED_1] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_2, printSeqLed}},
+  [SEQ_SPEED_2] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_3, printSeqLed}},
+  [SEQ_SPEED_3] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_1, printSeqLed}},
+};
+const StateDefinition seq3States[SEQ_STATES] = {
+  [SEQ_ROOT] = {STATE_NONE, SEQ_SPEED_1, 0, NULL, NULL, seq3Transitions[SEQ_ROOT]},
+  [SEQ_SPEED_1] = {SEQ_ROOT, STATE_NONE, 1, setSeqLedSpeed, NULL, seq3Transitions[SEQ_SPEED_1]},  // 0.25s
+  [SEQ_SPEED_2] = {SEQ_ROOT, STATE_NONE, 2, setSeqLedSpeed, NULL, seq3Transitions[SEQ_SPEED_2]},  // 0.5s
+  [SEQ_SPEED_3] = {SEQ_ROOT, STATE_NONE, 4, setSeqLedSpeed, NULL, seq3Transitions[SEQ_SPEED_3]},  // 1.0s
+};
+
+const StateTransition seq4Transitions[SEQ_STATES][MODE_EVENT_COUNT] = {
+  [SEQ_ROOT] = {[MODE_EVENT_RESET] = {SEQ_SPEED_1, NULL}},
+  [SEQ_SPEED_1] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_2, printSeqLed}},
+  [SEQ_SPEED_2] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_3, printSeqLed}},
+  [SEQ_SPEED_3] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_4, printSeqLed}},
+  [SEQ_SPEED_4] = {[MODE_EVENT_PRESS] = {SEQ_SPEED_1, printSeqLed}},
+};
+const StateDefinition seq4States[SEQ_STATES] = {
+  [SEQ_ROOT] = {STATE_NONE, SEQ_SPEED_1, 0, NULL, NULL, seq4Transitions[SEQ_ROOT]},
+  [SEQ_SPEED_1] = {SEQ_ROOT, STATE_NONE, 1, setSeqLedSpeed, NULL, seq4Transitions[SEQ_SPEED_1]},  // 0.25s
+  [SEQ_SPEED_2] = {SEQ_ROOT, STATE_NONE, 2, setSeqLedSpeed, NULL, seq4Transitions[SEQ_SPEED_2]},  // 0.5s
+  [SEQ_SPEED_3] = {SEQ_ROOT, STATE_NONE, 3, setSeqLedSpeed, NULL, seq4Transitions[SEQ_SPEED_3]},  // 0.75s
+  [SEQ_SPEED_4] = {SEQ_ROOT, STATE_NONE, 4, setSeqLedSpeed, NULL, seq4Transitions[SEQ_SPEED_4]},  // 1.0s
+};
+
+void printSeqLed(byte source, byte target) {
+  printf(seqLedMachine.states == seq4States ? "SeqLED4 State:%d\n" : "SeqLED State:%d\n", target - SEQ_ROOT);
+}
+
+/* LED 跑馬燈功能綁定：選擇 3 顆或 4 顆的狀態表並從最快速度開始播放 */
+void startSequentialLed(void) {
+  stateMachineBegin(&seqLedMachine, seq3States, MODE_EVENT_COUNT, SEQ_ROOT);
+  animationPlay(&ledPlayer, &chase3Animation);
+}
+
+void startSequentialLed4(void) {
+  stateMachineBegin(&seqLedMachine, seq4States, MODE_EVENT_COUNT, SEQ_ROOT);
+  animationPlay(&ledPlayer, &chase4Animation);
+}
+
+
+/*
+ * ============================================================================
+ * UART 輸入功能（ROUTE_INPUT_UART，value 為輸入的整數）
+ * ============================================================================
+ */
+/*
+ * 【功能】透過 UART 設定伺服馬達角度
+ *
+ * 輸入範圍轉換：
+ *   輸入 -90 → 實際角度 0°
+ *   輸入 0   → 實際角度 90°
+ *   輸入 90  → 實際角度 180°
+ */
+void setServoAngleUart(uint16_t value) {
+  // 將輸入角度轉換為 0-180° 範圍
+  int angle = ((int16_t)value + 90) % 181;
+  if (angle < 0)
+    angle += 180;
+
+  currentServoAngle = (uint16_t)angle;
+  printf("Servo Angle:%d\n", angle);
+  setCCP1ServoAngle(angle, 16);
+}
+
+/*
+ * 【功能】UART 輸入數字以二進位顯示在 LED
+ *
+ * 輸入範圍：0-15（超過 15 會被限制為 15）
+ *
+ * 範例：
+ * ┌───────┬─────────┬──────────────────┐
+ * │ 輸入  │ 二進位  │ LED (RD3-RD0)    │
+ * ├───────┼─────────┼──────────────────┤
+ * │   0   │  0000   │ ░░░░             │
+ * │   5   │  0101   │ ░█░█             │
+ * │  15   │  1111   │ ████             │
+ * │  20   │  1111   │ ████ (限制為 15) │
+ * └───────┴─────────┴──────────────────┘
+ */
+void uartToBinary(uint16_t input) {
+  int value = (int16_t)input;
+
+  // 限制數值範圍 0-15
+  if (value < 0) value = 0;
+  if (value > 15) value = 15;
+
+  led4Bit((byte)value);
+
+  // 輸出確認訊息
+  printf("Binary:%d -> %d%d%d%d\n", value,
+         (value >> 3) & 1, (value >> 2) & 1,
+         (value >> 1) & 1, (value >> 0) & 1);
+}
+
+
+/* 背景工作：輸出並清除中斷執行週期統計 */
+void printProfile(byte event) {
+  profileDump();
+  profileReset();
 }
 
 
@@ -175,12 +416,16 @@ void led4Bit(byte value) {
  *   len  - 字串長度
  *
  * 【支援的命令】
- *   'r'  - 重置所有狀態
- *   數字 - 根據啟用的功能執行不同動作：
- *          enableSetServoAngleUart: 設定伺服馬達角度（-90 到 +90）
- *          enableUartToBinary: 以二進位顯示在 LED（0-15）
+ *   'r'      - 重置所有狀態
+ *   'p'      - 輸出各中斷來源的執行週期統計並清除
+ *   'b <n>'  - 綁定第 n 條路由（資源衝突時回報佔用者）
+ *   'u <n>'  - 解除第 n 條路由
+ *   'l'      - 列出所有路由，已綁定者以 * 標示
+ *   數字     - 交給綁定到 UART 輸入的功能：
+ *              ROUTE_SERVO_ANGLE_UART: 設定伺服馬達角度（-90 到 +90）
+ *              ROUTE_UART_TO_BINARY: 以二進位顯示在 LED（0-15）
  *
- * 【注意】enableSetServoAngleUart 和 enableUartToBinary 不可同時啟用
+ * 【注意】兩個 UART 功能同時只能綁定一個
  */
 void onReadLine(char *line, byte len) {
   /*
@@ -188,14 +433,18 @@ void onReadLine(char *line, byte len) {
    */
   if (*line == 'r') {
     buttonClickCount = 0;
-    servoAngleState = 0;
-    servoTurnRangeState = 1;
-    seqLedSpeedState = 1;
-    seqLedPosition = 0;
-    seqLedCounter = 0;
-    seqLedThreshold = 1;
-
-    if (enableBinaryButtonCount) {
+
+    // 與按鈕工作同在低優先級中斷，直接分派 RESET
+    stateMachineDispatch(&servoRangeMachine, MODE_EVENT_RESET);
+    stateMachineDispatch(&servoAngleMachine, MODE_EVENT_RESET);
+    if (routeIsBound(ROUTE_SEQUENTIAL_LED_BUTTON) || routeIsBound(ROUTE_SEQUENTIAL_LED_BUTTON_4)) {
+      stateMachineDispatch(&seqLedMachine, MODE_EVENT_RESET);
+    }
+    if (ledPlayer.running) {
+      animationPlay(&ledPlayer, ledPlayer.animation);  // 從第一顆重新開始
+    }
+
+    if (routeIsBound(ROUTE_BINARY_BUTTON_COUNT)) {
       led4Bit((byte)buttonClickCount);
     }
     printf("Reset OK\n");
@@ -203,59 +452,46 @@ void onReadLine(char *line, byte len) {
   }
 
   /*
-   * 【功能】透過 UART 設定伺服馬達角度
-   *
-   * 輸入範圍轉換：
-   *   輸入 -90 → 實際角度 0°
-   *   輸入 0   → 實際角度 90°
-   *   輸入 90  → 實際角度 180°
+   * 【中斷分析命令】收到 'p' 時輸出並清除中斷執行週期統計
+   * 輸出較長，交給主迴圈（KERNEL_BACKGROUND）執行，不佔用低優先級中斷
    */
-  if (enableSetServoAngleUart) {
-    int i;
-    // 解析輸入的角度值（支援負數）
-    if (*line == '-')
-      i = -atoi(line + 1);  // 負數：跳過負號後轉換
-    else
-      i = atoi(line);       // 正數：直接轉換
-
-    // 將輸入角度轉換為 0-180° 範圍
-    currentServoAngle = (i + 90) % 181;
-    if (currentServoAngle < 0)
-      currentServoAngle += 180;
-
-    printf("Servo Angle:%d\n", currentServoAngle);
-    setCCP1ServoAngle(currentServoAngle, 16);
+  if (*line == 'p') {
+    kernelPost(KERNEL_BACKGROUND, printProfile, 0);
+    return;
   }
 
   /*
-   * 【功能】UART 輸入數字以二進位顯示在 LED
-   *
-   * 輸入範圍：0-15（超過 15 會被限制為 15）
-   *
-   * 範例：
-   * ┌───────┬─────────┬──────────────────┐
-   * │ 輸入  │ 二進位  │ LED (RD3-RD0)    │
-   * ├───────┼─────────┼──────────────────┤
-   * │   0   │  0000   │ ░░░░             │
-   * │   5   │  0101   │ ░█░█             │
-   * │  15   │  1111   │ ████             │
-   * │  20   │  1111   │ ████ (限制為 15) │
-   * └───────┴─────────┴──────────────────┘
+   * 【路由命令】綁定、解除、列出功能
    */
-  if (enableUartToBinary) {
-    int value = atoi(line);
-
-    // 限制數值範圍 0-15
-    if (value < 0) value = 0;
-    if (value > 15) value = 15;
-
-    led4Bit((byte)value);
-
-    // 輸出確認訊息
-    printf("Binary:%d -> %d%d%d%d\n", value,
-           (value >> 3) & 1, (value >> 2) & 1,
-           (value >> 1) & 1, (value >> 0) & 1);
+  if (*line == 'b') {
+    byte route = (byte)atoi(line + 1);
+    switch (routeBind(route)) {
+    case ROUTE_OK:
+      printf("Bind:%s\n", routeTable[route].name);
+      break;
+    case ROUTE_CONFLICT:
+      printf("Conflict:%s\n", routeTable[routeConflict(route)].name);
+      break;
+    case ROUTE_FULL:
+      printf("Bindings full\n");
+      break;
+    default:
+      printf("No route\n");
+      break;
+    }
+    return;
+  }
+  if (*line == 'u') {
+    printf(routeUnbind((byte)atoi(line + 1)) ? "Unbind OK\n" : "Not bound\n");
+    return;
+  }
+  if (*line == 'l') {
+    routeList();
+    return;
   }
+
+  // 數字（支援負數）交給綁定到 UART 輸入的功能
+  routeDispatch(ROUTE_INPUT_UART, (uint16_t)atoi(line));
 }
 
 
@@ -272,301 +508,257 @@ void onReadChar(char c) {}
 
 /*
  * ============================================================================
- * H_ISR - 高優先級中斷服務程式
+ * 按鈕功能（ROUTE_INPUT_BUTTON，value 為按下後的按鈕計數）
  * ============================================================================
- * 【功能】處理所有高優先級中斷事件
- *
- * 【處理的中斷源】
- *   1. RB0 外部按鈕中斷 - 處理按鈕點擊事件
- *   2. Timer1 溢位中斷 - LED 跑馬燈計時
- *   3. Timer3 溢位中斷 - （保留）
- *   4. ADC 轉換完成中斷 - 處理類比輸入
- *
- * 【中斷處理流程】
- *   檢查中斷源 → 執行對應處理 → 清除中斷旗標
  */
-uint16_t lastADC;  // 上一次 ADC 讀取值（用於平均濾波和方向判斷）
+// 【功能】以二進位方式顯示按鈕計數
+void binaryButtonCount(uint16_t count) {
+  led4Bit((byte)count);
+}
 
-void __interrupt(high_priority) H_ISR() {
+/*
+ * 【功能】按鈕切換模式（狀態機查表）
+ *   伺服馬達轉動範圍（5 種範圍，主迴圈依狀態擺動）
+ *   伺服馬達角度增量 45° → 90° → 180° → 循環
+ *   LED 跑馬燈速度（3 顆或 4 顆 LED，綁定時選擇狀態表）
+ */
+void servoTurnRangeSwitchButton(uint16_t count) {
+  stateMachineDispatch(&servoRangeMachine, MODE_EVENT_PRESS);
+}
 
-  /*
-   * ========================================
-   * RB0 外部按鈕中斷處理
-   * ========================================
-   * 觸發條件：RB0 腳位電平變化（按鈕按下）
-   */
-  if (interruptByRB0External()) {
-    __delay_ms(200);  // 消抖延遲，避免按鈕彈跳造成多次觸發
-    printf("Button%d\n", buttonClickCount++);
+void servoTurnAngleButton(uint16_t count) {
+  stateMachineDispatch(&servoAngleMachine, MODE_EVENT_PRESS);
+}
 
-    // 【功能】以二進位方式顯示按鈕計數
-    if (enableBinaryButtonCount) {
-      led4Bit((byte)buttonClickCount);
-    }
+void sequentialLedButton(uint16_t count) {
+  stateMachineDispatch(&seqLedMachine, MODE_EVENT_PRESS);
+}
 
-    /*
-     * 【功能】切換伺服馬達轉動範圍狀態（5 種範圍）
-     *
-     * State 1: 90° ↔ 180°  (上半範圍)
-     * State 2: 0° ↔ 180°   (全範圍)
-     * State 3: 0° ↔ 90°    (下半範圍)
-     * State 4: 45° ↔ 135°  (中間範圍)
-     * State 5: Sleep       (停止擺動)
-     */
-    if (enableServoTurnRangeSwitchButton) {
-      servoTurnRangeState = (servoTurnRangeState % 5) + 1;
-      printf("Servo Range State:%d\n", servoTurnRangeState);
-    }
 
-    /*
-     * 【功能】按鈕控制伺服馬達角度增量
-     * 使用狀態機切換不同的角度增量：45° → 90° → 180° → 循環
-     */
-    if (enableServoTurnAngleButton) {
-      switch (servoAngleState) {
-      case 0:
-        currentServoAngle += 45;
-        break;
-      case 1:
-        currentServoAngle += 90;
-        break;
-      case 2:
-        currentServoAngle += 180;
-        break;
-      }
-      servoAngleState = (servoAngleState + 1) % 3;
-      currentServoAngle %= 180;
-      setCCP1ServoAngle(currentServoAngle, 16);
-    }
+/*
+ * ============================================================================
+ * onButtonPress - 按鈕按下處理函式
+ * ============================================================================
+ * 【功能】處理 RB0 按鈕按下事件，交給綁定到按鈕輸入的功能
+ *
+ * 【呼叫時機】Timer3 中斷取樣去彈跳後投遞到 KERNEL_MEDIUM，在低優先級中斷中執行
+ *            輸出與模式切換可被 Timer1、ADC 等高優先級中斷搶佔，伺服馬達控制不會被延遲
+ *
+ * 【參數】event - 去彈跳事件
+ */
+void onButtonPress(byte event) {
+  printf("Button%u\n", buttonClickCount++);
+  routeDispatch(ROUTE_INPUT_BUTTON, buttonClickCount);
+}
 
-    /*
-     * 【功能】按鈕切換 LED 跑馬燈速度（3 顆 LED）
-     * State 1: 0.25s, State 2: 0.5s, State 3: 1.0s
-     */
-    if (enableSequentialLedButton) {
-      seqLedSpeedState = (seqLedSpeedState % 3) + 1;
-      switch (seqLedSpeedState) {
-      case 1: seqLedThreshold = 1; break;  // 0.25s
-      case 2: seqLedThreshold = 2; break;  // 0.5s
-      case 3: seqLedThreshold = 4; break;  // 1.0s
-      }
-      seqLedCounter = 0;
-      printf("SeqLED State:%d\n", seqLedSpeedState);
-    }
 
-    /*
-     * 【功能】按鈕切換 LED 跑馬燈速度（4 顆 LED）
-     * State 1: 0.25s, State 2: 0.5s, State 3: 0.75s, State 4: 1.0s
-     */
-    if (enableSequentialLedButton_4) {
-      seqLedSpeedState = (seqLedSpeedState % 4) + 1;
-      switch (seqLedSpeedState) {
-      case 1: seqLedThreshold = 1; break;  // 0.25s
-      case 2: seqLedThreshold = 2; break;  // 0.5s
-      case 3: seqLedThreshold = 3; break;  // 0.75s
-      case 4: seqLedThreshold = 4; break;  // 1.0s
-      }
-      seqLedCounter = 0;
-      printf("SeqLED4 State:%d\n", seqLedSpeedState);
-    }
+/*
+ * ============================================================================
+ * 高優先級中斷處理函式（由 INTERRUPT_TABLE 分派）
+ * ============================================================================
+ * 【處理的中斷源】
+ *   1. Timer3 溢位中斷 - 按鈕去彈跳取樣 (10ms)
+ *   2. Timer1 溢位中斷 - LED 跑馬燈計時
+ *   3. ADC 轉換完成中斷 - 處理類比輸入
+ *
+ * 【中斷處理流程】
+ *   分派器檢查旗標 → 呼叫對應處理函式 → 處理函式清除中斷旗標
+ */
+uint16_t lastADC;     // 上一次 ADC 讀取值（用於平均濾波和方向判斷）
+uint16_t currentADC;  // 本次 ADC 讀取值（奇偶數功能判斷方向）
 
-    clearInterrupt_RB0External();
+/*
+ * ========================================
+ * Timer3 溢位中斷處理
+ * ========================================
+ * 觸發條件：Timer3 計數器溢位
+ * 週期：10ms
+ * 用途：取樣 RB0 按鈕並去彈跳，連續 4 次取樣相同才視為狀態改變
+ */
+void onDebounceTick() {
+  addTimer3InterruptPeriod(10000, 8);  // 累加重設週期 10ms（1:8 預分頻每次最多慢約 12µs，去彈跳不需精確）
+  debounceTick();
+
+  byte event;
+  while ((event = debounceRead()) != DEBOUNCE_EVENT_NONE) {
+    if (event == (DEBOUNCE_EVENT_PRESS | DEBOUNCE_KEY(0, 0))) {
+      kernelPost(KERNEL_MEDIUM, onButtonPress, event);  // 離開高優先級中斷後執行
+    }
   }
 
+  clearInterrupt_Timer3Overflow();
+}
+
+/*
+ * ========================================
+ * Timer1 溢位中斷處理
+ * ========================================
+ * 觸發條件：Timer1 計數器溢位
+ * 週期：250ms
+ * 用途：LED 跑馬燈計時
+ */
+void onLedTick() {
+  addTimer1InterruptPeriod(250000, 8);  // 累加重設週期 250ms，中斷延遲不累積；預分頻器每次最多慢約 12µs（< 0.005%）
+
   /*
-   * ========================================
-   * Timer1 溢位中斷處理
-   * ========================================
-   * 觸發條件：Timer1 計數器溢位
-   * 週期：250ms
-   * 用途：LED 跑馬燈計時
+   * LED 跑馬燈動畫（chase3Animation / chase4Animation）
+   * 未播放時立即返回；換幀時一次寫入 LATD
    */
-  if (interruptByTimer1Overflow()) {
-    setTimer1InterruptPeriod(250000, 8);  // 重設週期 250ms
+  animationTick(&ledPlayer);
 
-    /*
-     * LED 跑馬燈計時處理（3 顆 LED）
-     * 使用 RD0, RD1, RD2 依序點亮
-     */
-    if (enableSequentialLedButton) {
-      seqLedCounter++;
-      if (seqLedCounter >= seqLedThreshold) {
-        seqLedCounter = 0;
-        seqLedPosition = (seqLedPosition + 1) % 3;
-        digitalWrite(PIN_RD0, seqLedPosition == 0 ? 1 : 0);
-        digitalWrite(PIN_RD1, seqLedPosition == 1 ? 1 : 0);
-        digitalWrite(PIN_RD2, seqLedPosition == 2 ? 1 : 0);
-      }
-    }
+  clearInterrupt_Timer1Overflow();
+}
 
-    /*
-     * LED 跑馬燈計時處理（4 顆 LED）
-     * 使用 RD0, RD1, RD2, RD3 依序點亮
-     */
-    if (enableSequentialLedButton_4) {
-      seqLedCounter++;
-      if (seqLedCounter >= seqLedThreshold) {
-        seqLedCounter = 0;
-        seqLedPosition = (seqLedPosition + 1) % 4;
-        digitalWrite(PIN_RD0, seqLedPosition == 0 ? 1 : 0);
-        digitalWrite(PIN_RD1, seqLedPosition == 1 ? 1 : 0);
-        digitalWrite(PIN_RD2, seqLedPosition == 2 ? 1 : 0);
-        digitalWrite(PIN_RD3, seqLedPosition == 3 ? 1 : 0);
-      }
-    }
+/*
+ * ========================================
+ * ADC 功能（ROUTE_INPUT_ADC，value 為濾波後的 ADC 值 0-1023）
+ * ========================================
+ */
+// 【功能】ADC 控制伺服馬達角度（0-180°）
+void servoADC(uint16_t ADC) {
+  setCCP1ServoAngle((int)(ADC * 180.0 / 1024), 16);
+}
 
-    clearInterrupt_Timer1Overflow();
-  }
+// 【功能】ADC 值以二進位顯示在 LED（0-15）
+void ledBinaryADC(uint16_t ADC) {
+  led4Bit((byte)(ADC * 15.0 / 1023));
+}
 
-  /*
-   * ========================================
-   * Timer3 溢位中斷處理（保留）
-   * ========================================
-   */
-  if (interruptByTimer3Overflow()) {
-    clearInterrupt_Timer3Overflow();
-  }
+// 【功能】ADC 控制 LED PWM 亮度
+void ledPwmADC(uint16_t ADC) {
+  setCCP2PwmDutyCycle((int)(ADC * 4100.0 / 1024), 16);
+}
 
-  /*
-   * ========================================
-   * ADC 轉換完成中斷處理
-   * ========================================
-   * 觸發條件：ADC 完成一次類比轉數位轉換
-   * ADC 數值範圍：0-1023（10 位元解析度）
-   */
-  if (interruptByADConverter()) {
-    uint16_t currentADC = getADConverter();
-    uint16_t ADC = (lastADC + currentADC) / 2;  // 簡單平均濾波
+// 【功能】ADC 控制 LED 跑馬燈位置（多顆同時亮）
+void ledMarqueeADC(uint16_t ADC) {
+  animationShow(&ledPlayer, &marqueeAnimation, (byte)(ADC * 8 / (1024 - 4)));
+}
 
-    // 【功能】ADC 控制伺服馬達角度（0-180°）
-    if (enableServoADC) {
-      setCCP1ServoAngle((int)(ADC * 180.0 / 1024), 16);
-    }
+/*
+ * 【功能】ADC 控制 LED 四段式閃爍頻率
+ *
+ * ADC 範圍分配：
+ * ┌──────────┬──────────┬──────────┬──────────┐
+ * │  0~255   │ 256~511  │ 512~767  │ 768~1023 │
+ * │ 0.25 秒  │ 0.5 秒   │ 0.75 秒  │ 1.0 秒   │
+ * └──────────┴──────────┴──────────┴──────────┘
+ */
+void ledFlashADC(uint16_t ADC) {
+  uint8_t newZone;
+  uint16_t newThreshold;
+
+  if (ADC < 256) {
+    newZone = 1;
+    newThreshold = 50;   // 0.25 秒
+  } else if (ADC < 512) {
+    newZone = 2;
+    newThreshold = 100;  // 0.5 秒
+  } else if (ADC < 768) {
+    newZone = 3;
+    newThreshold = 150;  // 0.75 秒
+  } else {
+    newZone = 4;
+    newThreshold = 200;  // 1.0 秒
+  }
 
-    // 【功能】ADC 值以二進位顯示在 LED（0-15）
-    if (enableLedBinaryADC) {
-      led4Bit((byte)(ADC * 15.0 / 1023));
-    }
+  if (newZone != ledFlashZone) {
+    ledFlashZone = newZone;
+    ledFlashCounter = 0;
+  }
 
-    // 【功能】ADC 控制 LED PWM 亮度
-    if (enableLedPwmADC) {
-      setCCP2PwmDutyCycle((int)(ADC * 4100.0 / 1024), 16);
-    }
+  ledFlashThreshold = newThreshold;
+  ledFlashCounter++;
 
-    // 【功能】ADC 控制 LED 跑馬燈位置（多顆同時亮）
-    if (enableLedMarqueeADC) {
-      int marqueePosition = (int)(ADC * 8 / (1024 - 4));
-      led4Bit((byte)(0b111100001111 >> marqueePosition));
-    }
+  if (ledFlashCounter >= ledFlashThreshold) {
+    ledFlashCounter = 0;
+    ledFlashState = !ledFlashState;
+    setCCP2PwmDutyCycle(ledFlashState ? 1024 : 0, 16);
+  }
+}
 
-    /*
-     * 【功能】ADC 控制 LED 四段式閃爍頻率
-     *
-     * ADC 範圍分配：
-     * ┌──────────┬──────────┬──────────┬──────────┐
-     * │  0~255   │ 256~511  │ 512~767  │ 768~1023 │
-     * │ 0.25 秒  │ 0.5 秒   │ 0.75 秒  │ 1.0 秒   │
-     * └──────────┴──────────┴──────────┴──────────┘
-     */
-    if (enableLedFlashADC) {
-      uint8_t newZone;
-      uint16_t newThreshold;
-
-      if (ADC < 256) {
-        newZone = 1;
-        newThreshold = 50;   // 0.25 秒
-      } else if (ADC < 512) {
-        newZone = 2;
-        newThreshold = 100;  // 0.5 秒
-      } else if (ADC < 768) {
-        newZone = 3;
-        newThreshold = 150;  // 0.75 秒
-      } else {
-        newZone = 4;
-        newThreshold = 200;  // 1.0 秒
-      }
+/*
+ * 【功能】ADC 控制單顆 LED 跑馬燈（左右兩端全滅）
+ *
+ * 6 個狀態：全滅 → RD0 → RD1 → RD2 → RD3 → 全滅
+ */
+void ledMarqueeSingleADC(uint16_t ADC) {
+  animationShow(&ledPlayer, &singleAnimation, (byte)(ADC / 171));  // 超出範圍時顯示最後一幀（全滅）
+}
 
-      if (newZone != ledFlashZone) {
-        ledFlashZone = newZone;
-        ledFlashCounter = 0;
-      }
+/*
+ * 【功能】ADC 映射到 10 個狀態（二進位顯示 0-9）
+ */
+void tenStateFromADC(uint16_t ADC) {
+  uint8_t state = ADC / 103;
+  if (state > 9) state = 9;
+  led4Bit((byte)state);
+}
 
-      ledFlashThreshold = newThreshold;
-      ledFlashCounter++;
+/*
+ * 【功能】ADC 映射到 7 個狀態（顯示日期 2025/12/03）
+ * 數字序列：2, 0, 2, 5, 12, 0, 3
+ */
+void todayStateFromADC(uint16_t ADC) {
+  animationShow(&ledPlayer, &dateAnimation, (byte)(ADC / 147));
+}
 
-      if (ledFlashCounter >= ledFlashThreshold) {
-        ledFlashCounter = 0;
-        ledFlashState = !ledFlashState;
-        setCCP2PwmDutyCycle(ledFlashState ? 1024 : 0, 16);
-      }
-    }
+/*
+ * 【功能】ADC 遞增/遞減顯示奇數/偶數
+ *
+ * 電壓遞增 → 顯示奇數：1, 3, 5, 7, 9, 11, 13, 15
+ * 電壓遞減 → 顯示偶數：0, 2, 4, 6, 8, 10, 12, 14
+ */
+void evenOddADC(uint16_t ADC) {
+  int16_t adcDiff = (int16_t)currentADC - (int16_t)lastADC;
+  if (adcDiff > 5) {
+    adcIncreasing = true;
+  } else if (adcDiff < -5) {
+    adcIncreasing = false;
+  }
 
-    /*
-     * 【功能】ADC 控制單顆 LED 跑馬燈（左右兩端全滅）
-     *
-     * 6 個狀態：全滅 → RD0 → RD1 → RD2 → RD3 → 全滅
-     */
-    if (enableLedMarqueeADC_Single) {
-      uint8_t ledPosition = ADC / 171;
-      if (ledPosition > 5) ledPosition = 5;
-
-      if (ledPosition == 0 || ledPosition == 5) {
-        led4Bit(0b0000);
-      } else {
-        led4Bit((byte)(1 << (ledPosition - 1)));
-      }
-    }
+  uint8_t state = ADC >> 7;  // ADC / 128
+  if (state > 7) state = 7;
 
-    /*
-     * 【功能】ADC 映射到 10 個狀態（二進位顯示 0-9）
-     */
-    if (enable10StateFromADC) {
-      uint8_t state = ADC / 103;
-      if (state > 9) state = 9;
-      led4Bit((byte)state);
-    }
+  byte displayValue = adcIncreasing ? (state * 2 + 1) : (state * 2);
+  led4Bit(displayValue);
+}
 
-    /*
-     * 【功能】ADC 映射到 7 個狀態（顯示日期 2025/12/03）
-     * 數字序列：2, 0, 2, 5, 12, 0, 3
-     */
-    if (enable7TodayStateFromADC) {
-      static const byte dateDigits[7] = {2, 0, 2, 5, 12, 0, 3};
-      uint8_t state = ADC / 147;
-      if (state > 6) state = 6;
-      led4Bit(dateDigits[state]);
-    }
+/* LED 閃爍與奇偶數功能綁定時重新開始計數 / 判斷方向 */
+void startLedFlash(void) {
+  ledFlashCounter = 0;
+  ledFlashZone = 1;
+  ledFlashState = false;
+}
 
-    /*
-     * 【功能】ADC 遞增/遞減顯示奇數/偶數
-     *
-     * 電壓遞增 → 顯示奇數：1, 3, 5, 7, 9, 11, 13, 15
-     * 電壓遞減 → 顯示偶數：0, 2, 4, 6, 8, 10, 12, 14
-     */
-    if (enableEvenOddADC) {
-      int16_t adcDiff = (int16_t)currentADC - (int16_t)lastADC;
-      if (adcDiff > 5) {
-        adcIncreasing = true;
-      } else if (adcDiff < -5) {
-        adcIncreasing = false;
-      }
+void startEvenOdd(void) {
+  adcIncreasing = true;
+}
 
-      uint8_t state = ADC >> 7;  // ADC / 128
-      if (state > 7) state = 7;
+/* PWM LED 功能解除綁定：熄滅 RC1 */
+void clearPwmLed(void) {
+  setCCP2PwmDutyCycle(0, 16);
+}
 
-      byte displayValue = adcIncreasing ? (state * 2 + 1) : (state * 2);
-      led4Bit(displayValue);
-    }
+/*
+ * ========================================
+ * ADC 轉換完成中斷處理
+ * ========================================
+ * 觸發條件：ADC 完成一次類比轉數位轉換
+ * ADC 數值範圍：0-1023（10 位元解析度）
+ * 只走訪目前綁定的功能，未綁定的功能不佔中斷時間
+ */
+void onADConverter() {
+  currentADC = getADConverter();
+  routeDispatch(ROUTE_INPUT_ADC, (lastADC + currentADC) / 2);  // 簡單平均濾波
 
-    lastADC = currentADC;
-    clearInterrupt_ADConverter();
-  }
+  lastADC = currentADC;
+  clearInterrupt_ADConverter();
 }
 
 
 /*
  * ============================================================================
- * Lo_ISR - 低優先級中斷服務程式
+ * 低優先級中斷處理函式
  * ============================================================================
  * 【功能】處理低優先級中斷事件（UART 串列接收）
  *
@@ -574,11 +766,38 @@ void __interrupt(high_priority) H_ISR() {
  * 當高優先級中斷發生時，低優先級中斷會被暫停
  * 這確保了時間關鍵的操作（如 ADC、Timer）不會被串列通訊延遲
  */
-void __interrupt(low_priority) Lo_ISR(void) {
-  if (processSerialReceive())
-    return;
+void onSerialReceive() {
+  processSerialReceive();
 }
 
+/* 依 INTERRUPT_TABLE 產生高/低優先級 ISR */
+INTERRUPT_DISPATCH()
+
+
+/*
+ * ============================================================================
+ * 路由表（程式記憶體，順序即 'l' 命令列出的編號）
+ * ============================================================================
+ */
+const RouteDefinition routes[ROUTE_COUNT] = {
+  [ROUTE_LED_BINARY_ADC] = {"LedBinaryADC", ROUTE_INPUT_ADC, RESOURCE_LEDS, ledBinaryADC, NULL, clearLeds},
+  [ROUTE_SERVO_ADC] = {"ServoADC", ROUTE_INPUT_ADC, RESOURCE_SERVO, servoADC, NULL, NULL},
+  [ROUTE_LED_PWM_ADC] = {"LedPwmADC", ROUTE_INPUT_ADC, RESOURCE_PWM_LED, ledPwmADC, NULL, clearPwmLed},
+  [ROUTE_LED_MARQUEE_ADC] = {"LedMarqueeADC", ROUTE_INPUT_ADC, RESOURCE_LEDS, ledMarqueeADC, NULL, clearLeds},
+  [ROUTE_BINARY_BUTTON_COUNT] = {"BinaryButtonCount", ROUTE_INPUT_BUTTON, RESOURCE_LEDS, binaryButtonCount, NULL, clearLeds},
+  [ROUTE_SERVO_RANGE_BUTTON] = {"ServoRangeButton", ROUTE_INPUT_BUTTON, RESOURCE_SERVO, servoTurnRangeSwitchButton, NULL, NULL},
+  [ROUTE_SERVO_ANGLE_UART] = {"ServoAngleUart", ROUTE_INPUT_UART, RESOURCE_SERVO | RESOURCE_UART_NUMBER, setServoAngleUart, NULL, NULL},
+  [ROUTE_SERVO_ANGLE_BUTTON] = {"ServoAngleButton", ROUTE_INPUT_BUTTON, RESOURCE_SERVO, servoTurnAngleButton, NULL, NULL},
+  [ROUTE_LED_FLASH_ADC] = {"LedFlashADC", ROUTE_INPUT_ADC, RESOURCE_PWM_LED, ledFlashADC, startLedFlash, clearPwmLed},
+  [ROUTE_LED_MARQUEE_SINGLE_ADC] = {"LedMarqueeSingleADC", ROUTE_INPUT_ADC, RESOURCE_LEDS, ledMarqueeSingleADC, NULL, clearLeds},
+  [ROUTE_10_STATE_ADC] = {"10StateADC", ROUTE_INPUT_ADC, RESOURCE_LEDS, tenStateFromADC, NULL, clearLeds},
+  [ROUTE_7_TODAY_STATE_ADC] = {"7TodayStateADC", ROUTE_INPUT_ADC, RESOURCE_LEDS, todayStateFromADC, NULL, clearLeds},
+  [ROUTE_EVEN_ODD_ADC] = {"EvenOddADC", ROUTE_INPUT_ADC, RESOURCE_LEDS, evenOddADC, startEvenOdd, clearLeds},
+  [ROUTE_SEQUENTIAL_LED_BUTTON] = {"SequentialLed", ROUTE_INPUT_BUTTON, RESOURCE_LEDS, sequentialLedButton, startSequentialLed, clearLeds},
+  [ROUTE_SEQUENTIAL_LED_BUTTON_4] = {"SequentialLed4", ROUTE_INPUT_BUTTON, RESOURCE_LEDS, sequentialLedButton, startSequentialLed4, clearLeds},
+  [ROUTE_UART_TO_BINARY] = {"UartToBinary", ROUTE_INPUT_UART, RESOURCE_LEDS | RESOURCE_UART_NUMBER, uartToBinary, NULL, clearLeds},
+};
+
 
 /*
  * ============================================================================
@@ -587,9 +806,9 @@ void __interrupt(low_priority) Lo_ISR(void) {
  * 【執行流程】
  *   1. 系統初始化（時脈、中斷）
  *   2. 外設初始化（按鈕、UART、LED、ADC、伺服馬達、PWM、Timer）
- *   3. 功能旗標設定
- *   4. 變數初始化
- *   5. 主迴圈（ADC 轉換、伺服馬達控制）
+ *   3. 變數初始化
+ *   4. 功能路由綁定
+ *   5. 主迴圈（背景工作、ADC 轉換、伺服馬達控制）
  */
 int main(void) {
 
@@ -607,7 +826,7 @@ int main(void) {
    * 第二階段：按鈕輸入設定 (RB0)
    * ======================================== */
   pinMode(PIN_RB0, PIN_INPUT);
-  enableInterrupt_RB0External();
+  debounceAddPort(0, PORTB, 0b00000001, 0b00000001);  // RB0 按鈕，接地按下為低電位
 
   /* ========================================
    * 第三階段：UART 串列通訊設定
@@ -625,10 +844,7 @@ int main(void) {
   pinMode(PIN_RD2, PIN_OUTPUT);
   pinMode(PIN_RD3, PIN_OUTPUT);
 
-  digitalWrite(PIN_RD0, 0);
-  digitalWrite(PIN_RD1, 0);
-  digitalWrite(PIN_RD2, 0);
-  digitalWrite(PIN_RD3, 0);
+  led4Bit(0);
 
   /* ========================================
    * 第五階段：ADC 類比輸入設定 (RA0/AN0)
@@ -638,7 +854,6 @@ int main(void) {
   setANPinADConfig(0b1110);
   setANPinAnalogChannelSelect(0);
   enableADConverter();
-  enableInterrupt_ADConverter(1);
 
   /* ========================================
    * 第六階段：伺服馬達設定 (RC2/CCP1)
@@ -662,55 +877,51 @@ int main(void) {
    * ======================================== */
   enableTimer1(TIMER1_PRESCALE_8);
   setTimer1InterruptPeriod(250000, 8);  // 250ms
-  enableInterrupt_Timer1Overflow(1);
 
-  /* ========================================
-   * 第九階段：功能旗標設定
-   * ======================================== */
-  enableLedBinaryADC = false;
-  enableServoADC = false;
-  enableLedPwmADC = false;
-  enableLedMarqueeADC = false;
-  enableBinaryButtonCount = false;
-  enableServoTurnRangeSwitchButton = false;
-  enableSetServoAngleUart = true;          // ← 啟用 UART 控制伺服馬達
-  enableServoTurnAngleButton = false;
-  enableLedFlashADC = false;
-  enableLedMarqueeADC_Single = false;
-  enable10StateFromADC = false;
-  enable7TodayStateFromADC = false;
-  enableEvenOddADC = false;
-  enableSequentialLedButton = false;
-  enableSequentialLedButton_4 = false;
-  enableUartToBinary = false;              // ← 注意：與上面互斥
+  /* Timer3：按鈕去彈跳取樣 10ms */
+  enableTimer3(TIMER3_PRESCALE_8);
+  setTimer3InterruptPeriod(10000, 8);
+
+  /* Timer0：中斷執行週期分析時基（16 位元 1:1 自由執行） */
+  profileBegin();
+
+  /* 依 INTERRUPT_TABLE 設定優先權並致能 Timer1、Timer3、ADC、UART 接收與核心中層（EE）中斷 */
+  interruptDispatchBegin();
 
   /* ========================================
-   * 第十階段：變數初始化
+   * 第九階段：變數初始化
    * ======================================== */
   adcIncreasing = true;
-  servoTurnRangeState = 1;
-  seqLedSpeedState = 1;
-  seqLedPosition = 0;
-  seqLedCounter = 0;
-  seqLedThreshold = 1;
   ledFlashCounter = 0;
   ledFlashThreshold = 50;
   ledFlashState = false;
   ledFlashZone = 1;
   buttonClickCount = 0;
   currentServoAngle = 0;
-  servoAngleState = 0;
   lastADC = 0;
 
+  /* LED 動畫與按鈕模式狀態機：進入初始狀態（跑馬燈狀態表在綁定時重新選擇） */
+  animationBegin(ledPlayer, LED_GROUP);
+  stateMachineBegin(&servoRangeMachine, rangeStates, MODE_EVENT_COUNT, RANGE_ROOT);
+  stateMachineBegin(&servoAngleMachine, angleStates, MODE_EVENT_COUNT, ANGLE_ROOT);
+  stateMachineBegin(&seqLedMachine, seq3States, MODE_EVENT_COUNT, SEQ_ROOT);
+
+  /* ========================================
+   * 第十階段：功能路由綁定（其他功能以 UART 命令 b <編號> 綁定）
+   * ======================================== */
+  routeBegin(routes, ROUTE_COUNT);
+  routeBind(ROUTE_SERVO_ANGLE_UART);  // ← 預設：UART 控制伺服馬達
+
   /* ========================================
    * 第十一階段：初始化完成
    * ======================================== */
-  printf("Ready!\n");
+  printf("Ready! ISR latency H:%u L:%u cycles\n", interruptHighLatency, interruptLowLatency);
 
   /* ========================================
    * 主迴圈
    * ======================================== */
   while (true) {
+    kernelRunBackground();  // 背景工作（'p' 統計輸出）
     startADConverter();
     __delay_ms(5);
 
@@ -723,33 +934,33 @@ int main(void) {
      * State 4: 45° ↔ 135°  (中間範圍)
      * State 5: Sleep       (停止擺動，固定 90°)
      */
-    if (enableServoTurnRangeSwitchButton) {
-      switch (servoTurnRangeState) {
-      case 1:
+    if (routeIsBound(ROUTE_SERVO_RANGE_BUTTON)) {
+      switch (stateMachineState(servoRangeMachine)) {
+      case RANGE_UPPER:
         setCCP1ServoAngle(180, 16);
         __delay_ms(600);
         setCCP1ServoAngle(90, 16);
         __delay_ms(600);
         break;
-      case 2:
+      case RANGE_FULL:
         setCCP1ServoAngle(180, 16);
         __delay_ms(600);
         setCCP1ServoAngle(0, 16);
         __delay_ms(600);
         break;
-      case 3:
+      case RANGE_LOWER:
         setCCP1ServoAngle(90, 16);
         __delay_ms(600);
         setCCP1ServoAngle(0, 16);
         __delay_ms(600);
         break;
-      case 4:
+      case RANGE_MIDDLE:
         setCCP1ServoAngle(135, 16);
         __delay_ms(600);
         setCCP1ServoAngle(45, 16);
         __delay_ms(600);
         break;
-      case 5:
+      case RANGE_SLEEP:
         // Sleep: 停止擺動，固定在 90°
         setCCP1ServoAngle(90, 16);
         __delay_ms(100);